@@ -6,11 +6,13 @@
   * @author  Frank Engelhardt <fengelha@ovgu.de>
   */
 #include <assert.h>
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include "doriot_dca.h"
+#include "byteorder.h"
 #include "net/gcoap.h"
 #include "od.h"
 #include "fmt.h"
@@ -19,18 +21,29 @@
 #include "debug.h"
 
 #define DCA_COAP_STRBUF_SIZE 128
+/* number of paths of a FETCH request resolved per db_get_many() call */
+#define DCA_COAP_FETCH_BATCH 8
 
 static ssize_t _encode_link(const coap_resource_t *resource, char *buf,
                             size_t maxlen, coap_link_encoder_ctx_t *context);
 static ssize_t _dca_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx);
+#ifdef CONFIG_DCA_NETWORK
+static ssize_t _dcatp_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx);
+#endif
 
 /* CoAP resources. Must be sorted by path (ASCII order). */
 static const coap_resource_t _resources[] = {
-    { "/dca", COAP_GET | COAP_MATCH_SUBTREE, _dca_handler, NULL },
+    { "/dca", COAP_GET | COAP_FETCH | COAP_MATCH_SUBTREE, _dca_handler, NULL },
+#ifdef CONFIG_DCA_NETWORK
+    { "/dcatp", COAP_POST, _dcatp_handler, NULL },
+#endif
 };
 
 static const char *_link_params[] = {
     ";ct=0;rt=\"dca\"",
+#ifdef CONFIG_DCA_NETWORK
+    ";ct=0;rt=\"dca.tp\"",
+#endif
     NULL
 };
 
@@ -61,6 +74,176 @@ static ssize_t _encode_link(const coap_resource_t *resource, char *buf,
 }
 
 
+/*
+ * FETCH: the payload lists one path per line, relative to the URI path.
+ * The response holds the value of each path on its own line, in the same
+ * order, or "---" if the path does not exist or is not a leaf.
+ */
+static ssize_t _dca_fetch(coap_pkt_t* pdu, uint8_t *buf, size_t len,
+                          const char *dbpath)
+{
+    db_node_t base;
+    if (db_find_node_by_path(dbpath, &base) < 0) {
+        DEBUG("invalid requst: %s\n", dbpath);
+        return gcoap_response(pdu, buf, len, COAP_CODE_404);
+    }
+
+    /* the response overwrites the request in buf, keep the path list */
+    char req[CONFIG_GCOAP_PDU_BUF_SIZE];
+    if (pdu->payload_len >= sizeof(req)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
+    }
+    memcpy(req, pdu->payload, pdu->payload_len);
+    req[pdu->payload_len] = '\0';
+
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    coap_opt_add_format(pdu, COAP_FORMAT_TEXT);
+    size_t resp_len = coap_opt_finish(pdu, COAP_OPT_FINISH_PAYLOAD);
+    char *out = (char *)pdu->payload;
+    size_t outlen = 0;
+
+    const char *paths[DCA_COAP_FETCH_BATCH];
+    db_result_t results[DCA_COAP_FETCH_BATCH];
+    char val[DCA_COAP_STRBUF_SIZE];
+    char *line = req;
+    while (*line != '\0') {
+        /* split the next batch of lines */
+        size_t num = 0;
+        while (*line != '\0' && num < DCA_COAP_FETCH_BATCH) {
+            char *end = line + strcspn(line, "\r\n");
+            if (end != line) {
+                paths[num++] = line;
+            }
+            line = end + strspn(end, "\r\n");
+            *end = '\0';
+        }
+        db_get_many(&base, paths, num, results);
+        for (size_t i = 0; i < num; i++) {
+            int r = db_result_to_str(&results[i], val, sizeof(val));
+            size_t vallen = (r > 0) ? (size_t)r - 1 : 3u;
+            if (r < 0) {
+                strcpy(val, "---");
+            }
+            if (outlen + vallen + 1 > pdu->payload_len) {
+                DEBUG("gcoap_cli: msg buffer too small\n");
+                return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+            }
+            memcpy(&out[outlen], val, vallen);
+            outlen += vallen;
+            out[outlen++] = '\n';
+        }
+    }
+    return resp_len + outlen;
+}
+
+/*
+ * Snapshot (block-wise): the first block takes a new snapshot, the following
+ * ones are read from it. The ETag is the snapshot's sequence number, big
+ * endian like in the snapshot's header, so a client notices if another client replaced the snapshot in between.
+ */
+static ssize_t _dca_snapshot(coap_pkt_t* pdu, uint8_t *buf, size_t len,
+                             const db_node_t *base)
+{
+    coap_block_slicer_t slicer;
+    uint32_t seq = 0;
+    network_uint32_t etag;
+    ssize_t size;
+
+    coap_block2_init(pdu, &slicer);
+    if (slicer.start == 0) {
+        size = db_snapshot_take(base, &seq);
+    }
+    else {
+        size = db_snapshot_read(&seq, 0, NULL, 0);
+    }
+    if (size < 0) {
+        DEBUG("snapshot failed: %d\n", (int)size);
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    etag = byteorder_htonl(seq);
+    coap_opt_add_opaque(pdu, COAP_OPT_ETAG, etag.u8, sizeof(etag));
+    coap_opt_add_format(pdu, COAP_FORMAT_OCTET);
+    coap_opt_add_block2(pdu, &slicer, 1);
+    size_t resp_len = coap_opt_finish(pdu, COAP_OPT_FINISH_PAYLOAD);
+
+    size_t blklen = slicer.end - slicer.start;
+    if (blklen > pdu->payload_len) {
+        DEBUG("gcoap_cli: msg buffer too small\n");
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+    size = db_snapshot_read(&seq, slicer.start, pdu->payload, blklen);
+    if (size < 0) {
+        /* replaced since the ETag was chosen, the client has to restart */
+        return gcoap_response(pdu, buf, len, COAP_CODE_SERVICE_UNAVAILABLE);
+    }
+    slicer.cur = size;
+    coap_block2_finish(&slicer);
+    if ((size_t)size <= slicer.start) {
+        return resp_len;
+    }
+    size -= slicer.start;
+    return resp_len + (((size_t)size < blklen) ? (size_t)size : blklen);
+}
+
+/* Name table of the snapshots (block-wise) */
+static ssize_t _dca_strtab(coap_pkt_t* pdu, uint8_t *buf, size_t len)
+{
+    coap_block_slicer_t slicer;
+
+    coap_block2_init(pdu, &slicer);
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    coap_opt_add_format(pdu, COAP_FORMAT_OCTET);
+    coap_opt_add_block2(pdu, &slicer, 1);
+    size_t resp_len = coap_opt_finish(pdu, COAP_OPT_FINISH_PAYLOAD);
+    resp_len += coap_blockwise_put_bytes(&slicer, pdu->payload,
+                                         (const uint8_t *)&db_fl_strtab,
+                                         sizeof(db_fl_strtab));
+    coap_block2_finish(&slicer);
+    return resp_len;
+}
+
+typedef struct {
+    coap_block_slicer_t slicer;
+    uint8_t *pos;
+} _dca_list_t;
+
+static int _dca_list_sink(const db_walk_event_t *ev, void *arg)
+{
+    _dca_list_t *list = arg;
+
+    if ((ev->depth == 0) || (ev->event == DB_WALK_LEAVE)) {
+        return 0;
+    }
+    list->pos += coap_blockwise_put_bytes(&list->slicer, list->pos,
+                                          (const uint8_t *)ev->name,
+                                          strlen(ev->name));
+    list->pos += coap_blockwise_put_char(&list->slicer, list->pos, ' ');
+    return 0;
+}
+
+/* List of all child nodes (block-wise), written while walking them */
+static ssize_t _dca_list(coap_pkt_t* pdu, uint8_t *buf, size_t len,
+                         const db_node_t *node)
+{
+    _dca_list_t list;
+
+    coap_block2_init(pdu, &list.slicer);
+    gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+    coap_opt_add_format(pdu, COAP_FORMAT_TEXT);
+    coap_opt_add_block2(pdu, &list.slicer, 1);
+    size_t resp_len = coap_opt_finish(pdu, COAP_OPT_FINISH_PAYLOAD);
+    if (list.slicer.end - list.slicer.start > pdu->payload_len) {
+        DEBUG("gcoap_cli: msg buffer too small\n");
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+    list.pos = pdu->payload;
+    db_walk(node, 1, _dca_list_sink, &list);
+    coap_block2_finish(&list.slicer);
+    return resp_len + (list.pos - pdu->payload);
+}
+
 static ssize_t _dca_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx)
 {
     (void)ctx;
@@ -69,6 +252,9 @@ static ssize_t _dca_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx
 
     /* get URI path and fetch the */
     size_t uripathlen = coap_get_uri_path(pdu, (uint8_t*)uripath);
+    if (coap_method2flag(coap_get_code_detail(pdu)) == COAP_FETCH) {
+        return _dca_fetch(pdu, buf, len, uripath + 4);
+    }
     if(uripathlen <= 4) {
         DEBUG("invalid requst: %s\n", uripath);
         return gcoap_response(pdu, buf, len, COAP_CODE_404);
@@ -77,28 +263,23 @@ static ssize_t _dca_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx
 
     /* fetch db entry */
     db_node_t node;
+    if (strcmp(dbpath, "/" DB_SNAPSHOT_STRTAB_NAME) == 0) {
+        return _dca_strtab(pdu, buf, len);
+    }
+    if (db_snapshot_find(dbpath, &node) == 0) {
+        return _dca_snapshot(pdu, buf, len, &node);
+    }
     int r = db_find_node_by_path(dbpath, &node);
     if(r < 0) {
         DEBUG("invalid requst: %s\n", uripath);
         return gcoap_response(pdu, buf, len, COAP_CODE_404);
     }
     char val[DCA_COAP_STRBUF_SIZE];
-    val[0] = '\0';
     size_t vallen = 0;
     db_node_type_t type = db_node_get_type(&node);
 
     if (type == db_node_type_inner) {
-        /* print a list of all child nodes */
-        db_node_t child;
-        db_node_get_next_child(&node, &child);
-        char name[DB_NODE_NAME_MAX];
-        while (!db_node_is_null(&child)) {
-            db_node_get_name(&child, name);
-            strncat(val, name, DCA_COAP_STRBUF_SIZE-1);
-            strncat(val, " ", DCA_COAP_STRBUF_SIZE-1);
-            db_node_get_next_child(&node, &child);
-        }
- 		vallen = strlen(val);
+        return _dca_list(pdu, buf, len, &node);
     }
     else if (type == db_node_type_int
              || type == db_node_type_float
@@ -126,6 +307,48 @@ static ssize_t _dca_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx
     }
 }
 
+#ifdef CONFIG_DCA_NETWORK
+/*
+ * POST /dcatp: start a bulk UDP test to all neighbors in the background. The
+ * payload holds the settings as for "dcatp bulk", e.g. "time 5000 size 256",
+ * the results show up in the fields of the neighbors.
+ */
+static ssize_t _dcatp_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len, void *ctx)
+{
+    (void)ctx;
+    udp_bulk_params_t params;
+    char req[DCA_COAP_STRBUF_SIZE];
+    const char *sep = " \t\r\n";
+    char *save = NULL;
+
+    if (pdu->payload_len >= sizeof(req)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
+    }
+    memcpy(req, pdu->payload, pdu->payload_len);
+    req[pdu->payload_len] = '\0';
+    udp_bulk_params_init(&params);
+    for (char *name = strtok_r(req, sep, &save); name;
+         name = strtok_r(NULL, sep, &save)) {
+        char *value = strtok_r(NULL, sep, &save);
+        if (!value || (udp_bulk_params_set(&params, name, value) < 0)) {
+            DEBUG("invalid setting: %s\n", name);
+            return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+        }
+    }
+    if ((params.duration_ms == 0) && (params.bytes == 0)) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+    }
+    int r = db_measure_network_bulk_async(&params);
+    if (r == -EBUSY) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_SERVICE_UNAVAILABLE);
+    }
+    if (r < 0) {
+        return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+    }
+    return gcoap_response(pdu, buf, len, COAP_CODE_CHANGED);
+}
+#endif
+
 int db_coap_init(void)
 {
     gcoap_register_listener(&_listener);
@@ -16,96 +16,143 @@
 #include "doriot_dca/ps.h"
 #include "doriot_dca/netif.h"
 #include "doriot_dca/saul_devices.h"
+#include "doriot_dca/sampler.h"
+#include "doriot_dca/udp_throughput.h"
 
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
-static db_fl_static_entry_t _board_static_entries[] =
+#define DB_FL_STRTAB_INIT(s) #s,
+
+const db_fl_strtab_t db_fl_strtab = {
+    DB_FL_STRINGS(DB_FL_STRTAB_INIT)
+};
+
+static const db_fl_static_entry_t _board_static_entries[] =
 {
-    {"name", db_node_type_str, (void (*)(void)) board_get_name},
-    {"mcu", db_node_type_str, (void (*)(void)) board_get_mcu},
-    {"ram", db_node_type_int, (void (*)(void)) board_get_ram},
-    {"clock", db_node_type_int, (void (*)(void)) board_get_clock},
-    {"nonvolatile", db_node_type_int, (void (*)(void)) board_get_nonvolatile}
+    {DB_STR(name), db_node_type_str, (void (*)(void)) board_get_name, 0},
+    {DB_STR(mcu), db_node_type_str, (void (*)(void)) board_get_mcu, 0},
+    {DB_STR(ram), db_node_type_int, (void (*)(void)) board_get_ram, 0},
+    {DB_STR(clock), db_node_type_int, (void (*)(void)) board_get_clock, 0},
+    {DB_STR(nonvolatile), db_node_type_int, (void (*)(void)) board_get_nonvolatile, 0}
 };
 
-static db_fl_static_entry_t _runtime_static_entries[] =
+static const db_fl_static_entry_t _runtime_static_entries[] =
 {
-    {"cpu_load", db_node_type_int, (void (*)(void)) runtime_get_cpu_load},
-    {"cpu_util", db_node_type_float, (void (*)(void)) runtime_get_cpu_util},
-    {"num_processes", db_node_type_int, (void (*)(void)) runtime_get_num_processes},
-    {"stack_used", db_node_type_int, (void (*)(void)) runtime_get_stack_used},
-    {"heap", db_node_type_int, (void (*)(void)) runtime_get_heap},
+    {DB_STR(cpu_load), db_node_type_int, (void (*)(void)) runtime_get_cpu_load, 0},
+    {DB_STR(cpu_util), db_node_type_float, (void (*)(void)) runtime_get_cpu_util, 0},
+    {DB_STR(num_processes), db_node_type_int, (void (*)(void)) runtime_get_num_processes, 0},
+    {DB_STR(stack_used), db_node_type_int, (void (*)(void)) runtime_get_stack_used,
+     CONFIG_DCA_STACK_USED_TTL_MS},
+    {DB_STR(heap), db_node_type_int, (void (*)(void)) runtime_get_heap, 0},
 };
 
-static db_fl_dynamic_entry_t _runtime_dynamic_entries[] =
+static const db_fl_dynamic_entry_t _runtime_dynamic_entries[] =
 {
 #if CONFIG_DCA_PS
-    {"ps", db_new_ps_node}
+    {DB_STR(ps), db_new_ps_node, DB_FL_SAMPLE_FN(db_sample_ps)}
 #endif /* CONFIG_DCA_PS */
 };
 
 #if CONFIG_DCA_SAUL
-static db_fl_static_entry_t _saul_static_entries[] =
+static const db_fl_static_entry_t _saul_static_entries[] =
 {
-    {"num_sensors", db_node_type_int, (void (*)(void)) saul_get_num_sensors},
-    {"num_actuators", db_node_type_int, (void (*)(void)) saul_get_num_actuators},
+    {DB_STR(num_sensors), db_node_type_int, (void (*)(void)) saul_get_num_sensors, 0},
+    {DB_STR(num_actuators), db_node_type_int, (void (*)(void)) saul_get_num_actuators, 0},
 };
 
-static db_fl_dynamic_entry_t _saul_dynamic_entries[] =
+static const db_fl_dynamic_entry_t _saul_dynamic_entries[] =
 {
-    {"devices", db_new_saul_node}
+    {DB_STR(devices), db_new_saul_node, NULL}
 };
 #endif /* CONFIG_DCA_SAUL */
 
 #if CONFIG_DCA_NETWORK
-static db_fl_static_entry_t _network_static_entries[] =
+static const db_fl_static_entry_t _network_static_entries[] =
 {
-    {"num_ifaces", db_node_type_int, (void (*)(void)) network_get_num_ifaces},
+    {DB_STR(num_ifaces), db_node_type_int, (void (*)(void)) network_get_num_ifaces, 0},
+    {DB_STR(neighbors), db_node_type_int, (void (*)(void)) neighbor_table_get_num, 0},
+    {DB_STR(neighbors_evicted), db_node_type_int, (void (*)(void)) neighbor_table_get_evicted, 0},
+    {DB_STR(neighbors_expired), db_node_type_int, (void (*)(void)) neighbor_table_get_expired, 0},
+    {DB_STR(udp_sessions), db_node_type_int, (void (*)(void)) udp_server_get_sessions, 0},
+    {DB_STR(udp_rejected), db_node_type_int, (void (*)(void)) udp_server_get_rejected, 0},
+    {DB_STR(udp_expired), db_node_type_int, (void (*)(void)) udp_server_get_expired, 0},
+    {DB_STR(udp_dropped), db_node_type_int, (void (*)(void)) udp_server_get_dropped, 0},
 };
 
-static db_fl_dynamic_entry_t _network_dynamic_entries[] =
+static const db_fl_dynamic_entry_t _network_dynamic_entries[] =
 {
-    {"netif", db_new_netif_node}
+    {DB_STR(netif), db_new_netif_node, DB_FL_SAMPLE_FN(db_sample_netif)}
 };
 #endif /* CONFIG_DCA_NETWORK */
 
-db_fl_entry_t db_index[] =
+static const db_fl_static_entry_t _dca_static_entries[] =
 {
-    {
-        .branch_name = "board",
+    {DB_STR(sampler_runs), db_node_type_int, (void (*)(void)) sampler_get_runs, 0},
+    {DB_STR(sampler_last_us), db_node_type_int, (void (*)(void)) sampler_get_last_us, 0},
+    {DB_STR(sampler_util), db_node_type_float, (void (*)(void)) sampler_get_util, 0},
+    {DB_STR(cache_hits), db_node_type_int, (void (*)(void)) db_cache_get_hits, 0},
+    {DB_STR(cache_misses), db_node_type_int, (void (*)(void)) db_cache_get_misses, 0},
+};
+
+/* shadow stores for sampled and cached values */
+static db_cache_entry_t _runtime_shadow[ARRAY_SIZE(_runtime_static_entries)];
+#if CONFIG_DCA_NETWORK
+static db_cache_entry_t _network_shadow[ARRAY_SIZE(_network_static_entries)];
+#endif /* CONFIG_DCA_NETWORK */
+#if CONFIG_DCA_SAUL
+static db_cache_entry_t _saul_shadow[ARRAY_SIZE(_saul_static_entries)];
+#endif /* CONFIG_DCA_SAUL */
+
+const db_fl_entry_t db_index[] =
+{
+    [DB_FL_BOARD] = {
+        .branch_name = DB_STR(board),
         .num_static_entries = ARRAY_SIZE(_board_static_entries),
         .static_entries = _board_static_entries,
         .num_dynamic_entries = 0,
         .dynamic_entries = 0
     },
-    {
-        .branch_name = "runtime",
+    [DB_FL_RUNTIME] = {
+        .branch_name = DB_STR(runtime),
         .num_static_entries = ARRAY_SIZE(_runtime_static_entries),
         .static_entries = _runtime_static_entries,
         .num_dynamic_entries = ARRAY_SIZE(_runtime_dynamic_entries),
-        .dynamic_entries = _runtime_dynamic_entries
+        .dynamic_entries = _runtime_dynamic_entries,
+        .shadow = _runtime_shadow,
+        .sample_period = CONFIG_DCA_SAMPLER_RUNTIME_PERIOD_MS
     },
 #if CONFIG_DCA_NETWORK
-    {
-        .branch_name = "network",
+    [DB_FL_NETWORK] = {
+        .branch_name = DB_STR(network),
         .num_static_entries = ARRAY_SIZE(_network_static_entries),
         .static_entries = _network_static_entries,
         .num_dynamic_entries = ARRAY_SIZE(_network_dynamic_entries),
-        .dynamic_entries = _network_dynamic_entries
+        .dynamic_entries = _network_dynamic_entries,
+        .shadow = _network_shadow,
+        .sample_period = CONFIG_DCA_SAMPLER_NETWORK_PERIOD_MS
     },
 #endif /* CONFIG_DCA_NETWORK */
 #if CONFIG_DCA_SAUL
-    {
-        .branch_name = "saul",
+    [DB_FL_SAUL] = {
+        .branch_name = DB_STR(saul),
         .num_static_entries = ARRAY_SIZE(_saul_static_entries),
         .static_entries = _saul_static_entries,
         .num_dynamic_entries = ARRAY_SIZE(_saul_dynamic_entries),
-        .dynamic_entries = _saul_dynamic_entries
+        .dynamic_entries = _saul_dynamic_entries,
+        .shadow = _saul_shadow,
+        .sample_period = CONFIG_DCA_SAMPLER_SAUL_PERIOD_MS
     },
 #endif /* CONFIG_DCA_SAUL */
+    [DB_FL_DCA] = {
+        .branch_name = DB_STR(dca),
+        .num_static_entries = ARRAY_SIZE(_dca_static_entries),
+        .static_entries = _dca_static_entries,
+        .num_dynamic_entries = 0,
+        .dynamic_entries = 0
+    },
 };
 
 size_t db_get_num_fl_nodes(void) {
@@ -151,7 +198,13 @@ size_t _root_get_size (const db_node_t *node) {
     return 0u;
 }
 
-static db_node_ops_t _db_root_ops = {
+int _root_find_child (const db_node_t *node, const char *name, size_t len,
+                      db_node_t *child) {
+    (void) node;
+    return db_fl_find_path(name, len, child);
+}
+
+static const db_node_ops_t _db_root_ops = {
     .get_name_fn = _root_get_name,
     .get_next_child_fn = _root_get_next_child,
     .get_next_fn = _root_get_next,
@@ -159,7 +212,8 @@ static db_node_ops_t _db_root_ops = {
     .get_size_fn = _root_get_size,
     .get_int_value_fn = NULL,
     .get_float_value_fn = NULL,
-    .get_str_value_fn = NULL
+    .get_str_value_fn = NULL,
+    .find_child_fn = _root_find_child
 };
 
 void db_get_root(db_node_t* node) {
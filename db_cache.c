@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/db_cache.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+#include "atomic_utils.h"
+#include "xtimer.h"
+
+static uint32_t _hits = 0;
+static uint32_t _misses = 0;
+
+int db_cache_get(seqlock_t *lock, const db_cache_entry_t *entry,
+                 uint32_t max_age, db_value_t *value)
+{
+    db_cache_entry_t copy;
+    unsigned seq;
+    do {
+        seq = seqlock_read_begin(lock);
+        copy = *entry;
+    } while (seqlock_read_retry(lock, seq));
+
+    if (copy.time == 0 || xtimer_now_usec() - copy.time > max_age) {
+        atomic_fetch_add_u32(&_misses, 1);
+        return -ENODATA;
+    }
+    atomic_fetch_add_u32(&_hits, 1);
+    *value = copy.value;
+    return 0;
+}
+
+void db_cache_put(seqlock_t *lock, db_cache_entry_t *entry, db_value_t value)
+{
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(lock);
+    entry->value = value;
+    /* 0 marks an empty entry */
+    entry->time = now ? now : 1;
+    seqlock_write_end(lock);
+}
+
+int32_t db_cache_get_hits(void)
+{
+    return atomic_load_u32(&_hits);
+}
+
+int32_t db_cache_get_misses(void)
+{
+    return atomic_load_u32(&_misses);
+}
@@ -11,12 +11,16 @@
 
 #include "doriot_dca/db.h"
 #include "doriot_dca/db_fl.h"
+#include "doriot_dca/sampler.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 
+#include "xtimer.h"
+
 typedef struct {
     /* if firstlevel branch root: index for enumerating the leaf nodes */
     /* if not: index of current node */
@@ -27,6 +31,21 @@ typedef struct {
     uint8_t fl_idx;
 } _db_fl_node_private_data_t;
 
+/* Static path index, see dist/gen_db_phash.py */
+typedef struct {
+    /* path below the root, without leading '/' */
+    const char *path;
+    /* element in db_index[] */
+    uint8_t fl_idx;
+    /* static entries first, then dynamic ones, or DB_FL_SUB_NONE */
+    uint8_t sub_idx;
+} db_phash_entry_t;
+
+#include "db_phash.h"
+
+/* one per branch, protects its shadow store; zero is the unlocked state */
+static seqlock_t _shadow_lock[DB_FL_NUMOF];
+
 char* _fl_node_getname (const db_node_t *node, char name[DB_NODE_NAME_MAX]);
 int _fl_node_getnext_child (db_node_t *node, db_node_t *next_child);
 int _fl_node_getnext (db_node_t *node, db_node_t *next);
@@ -35,8 +54,10 @@ size_t _fl_node_getsize (const db_node_t *node);
 int32_t _fl_node_getint_value (const db_node_t *node);
 float _fl_node_getfloat_value (const db_node_t *node);
 size_t _fl_node_getstr_value (const db_node_t *node, char *value, size_t bufsize);
+int _fl_node_find_child (const db_node_t *node, const char *name, size_t len,
+                         db_node_t *child);
 
-static db_node_ops_t _db_fl_node_ops = {
+static const db_node_ops_t _db_fl_node_ops = {
     .get_name_fn = _fl_node_getname,
     .get_next_child_fn = _fl_node_getnext_child,
     .get_next_fn = _fl_node_getnext,
@@ -44,9 +65,46 @@ static db_node_ops_t _db_fl_node_ops = {
     .get_size_fn = _fl_node_getsize,
     .get_int_value_fn = _fl_node_getint_value,
     .get_float_value_fn = _fl_node_getfloat_value,
-    .get_str_value_fn = _fl_node_getstr_value
+    .get_str_value_fn = _fl_node_getstr_value,
+    .find_child_fn = _fl_node_find_child
 };
 
+/* FNV-1a, seeded with the displacement. Must match dist/gen_db_phash.py */
+static uint32_t _db_phash(uint32_t seed, const char *key, size_t len) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const db_phash_entry_t *_db_phash_lookup(const char *key, size_t len) {
+    uint8_t disp = _db_phash_disp[_db_phash(0, key, len) % DB_PHASH_NUM_KEYS];
+    const db_phash_entry_t *ent =
+        &_db_phash_entries[_db_phash(disp, key, len) % DB_PHASH_NUM_KEYS];
+    /* slots of entries that are disabled in this configuration are empty */
+    if ((ent->path == NULL) || (strncmp(ent->path, key, len) != 0)
+            || (ent->path[len] != '\0')) {
+        return NULL;
+    }
+    return ent;
+}
+
+db_str_t db_str_find(const char *name) {
+    assert(name);
+    const char *strtab = (const char *)&db_fl_strtab;
+    size_t off = 0;
+    while (off < sizeof(db_fl_strtab)) {
+        size_t len = strlen(&strtab[off]);
+        if ((strtab[off] == name[0]) && (strcmp(&strtab[off], name) == 0)) {
+            return (db_str_t)off;
+        }
+        off += len + 1;
+    }
+    return DB_STR_NONE;
+}
+
 /* fl node constructor */
 void _fl_node_init(db_node_t *node, uint8_t fl_idx, uint8_t sub_idx, uint8_t is_root) {
     node->ops = &_db_fl_node_ops;
@@ -64,19 +122,41 @@ void db_new_fl_node(db_node_t *node, uint8_t fl_idx) {
     _fl_node_init(node, fl_idx, 0u, 1u);
 }
 
+int db_fl_find_path(const char *path, size_t len, db_node_t *node) {
+    assert(path);
+    assert(node);
+    const db_phash_entry_t *ent = _db_phash_lookup(path, len);
+    if (ent == NULL) {
+        return -ENOENT;
+    }
+    const db_fl_entry_t *fl_ent = &db_index[ent->fl_idx];
+    if (ent->sub_idx == DB_FL_SUB_NONE) {
+        db_new_fl_node(node, ent->fl_idx);
+    }
+    else if (ent->sub_idx < fl_ent->num_static_entries) {
+        _fl_node_init(node, ent->fl_idx, ent->sub_idx, 0u);
+    }
+    else {
+        fl_ent->dynamic_entries[ent->sub_idx - fl_ent->num_static_entries]
+            .get_node_fn(node);
+    }
+    return 0;
+}
+
 char* _fl_node_getname (const db_node_t *node, char name[DB_NODE_NAME_MAX]) {
     assert(node);
     assert(name);
     _db_fl_node_private_data_t *private_data =
         (_db_fl_node_private_data_t*) node->private_data.u8;
     assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+    const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
     if(private_data->is_root) {
-        strncpy(name, fl_ent->branch_name, DB_NODE_NAME_MAX);
+        strncpy(name, db_str(fl_ent->branch_name), DB_NODE_NAME_MAX);
     }
     else {
         assert(private_data->sub_idx < fl_ent->num_static_entries);
-        strncpy(name, fl_ent->static_entries[private_data->sub_idx].name, DB_NODE_NAME_MAX);
+        strncpy(name, db_str(fl_ent->static_entries[private_data->sub_idx].name),
+                DB_NODE_NAME_MAX);
     }
     return name;
 }
@@ -87,7 +167,7 @@ int _fl_node_getnext_child (db_node_t *node, db_node_t *next_child) {
     _db_fl_node_private_data_t *private_data =
         (_db_fl_node_private_data_t*) node->private_data.u8;
     assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+    const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
     if(private_data->is_root) {
         /* return child node at sub_idx, advance sub_idx */
         if(private_data->sub_idx < fl_ent->num_static_entries) {
@@ -99,7 +179,7 @@ int _fl_node_getnext_child (db_node_t *node, db_node_t *next_child) {
             uint8_t dyn_sub_idx =
                 private_data->sub_idx - fl_ent->num_static_entries;
             if(dyn_sub_idx < fl_ent->num_dynamic_entries) {
-                db_fl_dynamic_entry_t *dyn_ent =
+                const db_fl_dynamic_entry_t *dyn_ent =
                     &fl_ent->dynamic_entries[dyn_sub_idx];
                 private_data->sub_idx += 1;
                 dyn_ent->get_node_fn(next_child);
@@ -123,7 +203,7 @@ int _fl_node_getnext (db_node_t *node, db_node_t *next) {
     _db_fl_node_private_data_t *private_data =
         (_db_fl_node_private_data_t*) node->private_data.u8;
     assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+    const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
     if(private_data->is_root) {
         /* retrieve the next firstlevel branch from db_index */
         if(private_data->fl_idx+1u < db_get_num_fl_nodes()) {
@@ -158,7 +238,7 @@ db_node_type_t _fl_node_gettype (const db_node_t *node) {
     }
     else {
         assert(private_data->fl_idx < db_get_num_fl_nodes());
-        db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+        const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
         assert(private_data->sub_idx < fl_ent->num_static_entries);
         return fl_ent->static_entries[private_data->sub_idx].type;
     }
@@ -173,7 +253,7 @@ size_t _fl_node_getsize (const db_node_t *node) {
     }
     else {
         assert(private_data->fl_idx < db_get_num_fl_nodes());
-        db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+        const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
         char buf[128]; // so the max length is always 128
         assert(private_data->sub_idx < fl_ent->num_static_entries);
         switch(fl_ent->static_entries[private_data->sub_idx].type) {
@@ -190,32 +270,97 @@ size_t _fl_node_getsize (const db_node_t *node) {
     return 0u;
 }
 
-int32_t _fl_node_getint_value (const db_node_t *node) {
+/* value of an int or float entry: sampled, cached or computed */
+static db_value_t _fl_node_get_value (const db_node_t *node) {
     _db_fl_node_private_data_t *private_data =
         (_db_fl_node_private_data_t*) node->private_data.u8;
-    assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
-    assert(private_data->sub_idx < fl_ent->num_static_entries);
-    return ( (int32_t (*)(void))
-        fl_ent->static_entries[private_data->sub_idx].get_value_fn)();
+    uint8_t fl_idx = private_data->fl_idx;
+    uint8_t sub_idx = private_data->sub_idx;
+    assert(fl_idx < db_get_num_fl_nodes());
+    const db_fl_entry_t *fl_ent = &db_index[fl_idx];
+    assert(sub_idx < fl_ent->num_static_entries);
+    const db_fl_static_entry_t *ent = &fl_ent->static_entries[sub_idx];
+    db_value_t value;
+
+    if (fl_ent->shadow) {
+        if (sampler_read(fl_idx, sub_idx, &value) == 0) {
+            return value;
+        }
+        if (ent->ttl &&
+            db_fl_shadow_get(fl_idx, sub_idx, ent->ttl * US_PER_MS, &value) == 0) {
+            return value;
+        }
+    }
+    if (ent->type == db_node_type_float) {
+        value.f = ((float (*)(void))ent->get_value_fn)();
+    }
+    else {
+        value.i = ((int32_t (*)(void))ent->get_value_fn)();
+    }
+    if (fl_ent->shadow && ent->ttl) {
+        db_fl_shadow_put(fl_idx, sub_idx, value);
+    }
+    return value;
+}
+
+int32_t _fl_node_getint_value (const db_node_t *node) {
+    return _fl_node_get_value(node).i;
 }
 
 float _fl_node_getfloat_value (const db_node_t *node) {
-    _db_fl_node_private_data_t *private_data =
-        (_db_fl_node_private_data_t*) node->private_data.u8;
-    assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
-    assert(private_data->sub_idx < fl_ent->num_static_entries);
-    return ( (float (*)(void))
-        fl_ent->static_entries[private_data->sub_idx].get_value_fn)();
+    return _fl_node_get_value(node).f;
 }
 
 size_t _fl_node_getstr_value (const db_node_t *node, char *value, size_t bufsize) {
     _db_fl_node_private_data_t *private_data =
         (_db_fl_node_private_data_t*) node->private_data.u8;
     assert(private_data->fl_idx < db_get_num_fl_nodes());
-    db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
+    const db_fl_entry_t *fl_ent = &db_index[private_data->fl_idx];
     assert(private_data->sub_idx < fl_ent->num_static_entries);
     return ( (size_t (*)(char*, size_t))
         fl_ent->static_entries[private_data->sub_idx].get_value_fn)(value, bufsize);
 }
+
+int _fl_node_find_child (const db_node_t *node, const char *name, size_t len,
+                         db_node_t *child) {
+    assert(node);
+    assert(child);
+    _db_fl_node_private_data_t *private_data =
+        (_db_fl_node_private_data_t*) node->private_data.u8;
+    assert(private_data->fl_idx < db_get_num_fl_nodes());
+    if (!private_data->is_root) {
+        /* static db entries do not have children */
+        return -ENOENT;
+    }
+    /* the index is keyed by "<branch>/<name>" */
+    char key[2 * DB_NODE_NAME_MAX];
+    const char *branch_name = db_str(db_index[private_data->fl_idx].branch_name);
+    size_t branch_len = strlen(branch_name);
+    if (len >= DB_NODE_NAME_MAX) {
+        return -ENOENT;
+    }
+    memcpy(key, branch_name, branch_len);
+    key[branch_len] = '/';
+    memcpy(&key[branch_len + 1], name, len);
+    return db_fl_find_path(key, branch_len + 1 + len, child);
+}
+
+int db_fl_shadow_get(uint8_t fl_idx, uint8_t sub_idx, uint32_t max_age,
+                     db_value_t *value)
+{
+    assert(fl_idx < DB_FL_NUMOF);
+    const db_fl_entry_t *fl_ent = &db_index[fl_idx];
+    assert(fl_ent->shadow);
+    assert(sub_idx < fl_ent->num_static_entries);
+    return db_cache_get(&_shadow_lock[fl_idx], &fl_ent->shadow[sub_idx],
+                        max_age, value);
+}
+
+void db_fl_shadow_put(uint8_t fl_idx, uint8_t sub_idx, db_value_t value)
+{
+    assert(fl_idx < DB_FL_NUMOF);
+    const db_fl_entry_t *fl_ent = &db_index[fl_idx];
+    assert(fl_ent->shadow);
+    assert(sub_idx < fl_ent->num_static_entries);
+    db_cache_put(&_shadow_lock[fl_idx], &fl_ent->shadow[sub_idx], value);
+}
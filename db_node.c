@@ -7,6 +7,7 @@
  */
 #include "doriot_dca/db.h"
 #include "doriot_dca/board.h"
+#include "doriot_dca/db_fl.h"
 
 #include <assert.h>
 #include <string.h>
@@ -25,7 +26,7 @@ db_node_type_t _db_node_null_get_type(const db_node_t *node)
     return db_node_type_null;
 }
 
-static db_node_ops_t _db_node_null_ops = {
+static const db_node_ops_t _db_node_null_ops = {
     .get_name_fn = NULL,
     .get_next_child_fn = NULL,
     .get_next_fn = NULL,
@@ -33,7 +34,8 @@ static db_node_ops_t _db_node_null_ops = {
     .get_size_fn = NULL,
     .get_int_value_fn = NULL,
     .get_float_value_fn = NULL,
-    .get_str_value_fn = NULL
+    .get_str_value_fn = NULL,
+    .find_child_fn = NULL
 };
 
 void db_node_set_null(db_node_t *node)
@@ -56,26 +58,52 @@ void db_node_copy(db_node_t *dest, const db_node_t *src)
     memcpy(dest, src, sizeof(db_node_t));
 }
 
+/* end of the path component starting at tok */
+static const char *_component_end(const char *tok, const char *path_end)
+{
+    const char *s_pos = memchr(tok, '/', path_end - tok);
+    return (s_pos == NULL) ? path_end : s_pos;
+}
+
+/* skip the slashes at tok */
+static const char *_skip_slashes(const char *tok, const char *path_end)
+{
+    while ((tok != path_end) && (*tok == '/')) {
+        tok += 1;
+    }
+    return tok;
+}
+
 int db_find_node_by_path(const char *path, db_node_t *node)
+{
+    assert(path);
+    return db_find_node_by_path_len(path, strlen(path), node);
+}
+
+int db_find_node_by_path_len(const char *path, size_t len, db_node_t *node)
 {
     assert(path);
     assert(node);
     /* find all the / in path and iterate over the folders */
-    char name_buf[DB_NODE_NAME_MAX];
     db_node_t child_node;
-    const char *tok = path;
-
-    while (*tok == '/') {
-        tok += 1;
-    }
-    const char *path_end = &path[strlen(path)];
-    const char *s_pos = strchr(tok, '/');
+    const char *path_end = &path[len];
+    const char *tok = _skip_slashes(path, path_end);
+    const char *s_pos = _component_end(tok, path_end);
 
-    if (s_pos == NULL) {
-        s_pos = path_end;
-    }
     db_get_root(node);
-    DEBUG("db_find_node_by_path(): path: \"%s\"\n", path);
+    DEBUG("db_find_node_by_path(): path: \"%.*s\"\n", (int)len, path);
+    if (tok != path_end) {
+        /* static part of the tree: resolve up to two levels at once */
+        const char *prefix_end = s_pos;
+        if ((path_end - s_pos > 1) && (s_pos[1] != '/')) {
+            prefix_end = _component_end(s_pos + 1, path_end);
+        }
+        if (db_fl_find_path(tok, prefix_end - tok, &child_node) == 0) {
+            memcpy(node, &child_node, sizeof(db_node_t));
+            tok = _skip_slashes(prefix_end, path_end);
+            s_pos = _component_end(tok, path_end);
+        }
+    }
     while (tok != path_end) { /* for every folder in path */
         DEBUG("db_find_node_by_path(): path: %p, tok: %p, s_pos: %p, path_end: %p\n", path, tok,
               s_pos, path_end);
@@ -85,27 +113,123 @@ int db_find_node_by_path(const char *path, db_node_t *node)
         assert(s_pos <= path_end);
         assert(tok <= s_pos);
         assert(!db_node_is_null(node));
-        size_t len = s_pos - tok;
-        do { /* for every folder in node */
-            db_node_get_next_child(node, &child_node);
-            if (db_node_is_null(&child_node)) {
-                /* we have searched through all entries */
-                return -ENOENT;
-            }
-            db_node_get_name(&child_node, name_buf);
-        }while(memcmp(tok, name_buf, len) != 0);
+        int r = db_node_find_child(node, tok, s_pos - tok, &child_node);
+        if (r < 0) {
+            return r;
+        }
         /* folder found, now descent */
         memcpy(node, &child_node, sizeof(db_node_t));
-        tok = s_pos;
-        while (*tok == '/') {
-            tok += 1;
+        tok = _skip_slashes(s_pos, path_end);
+        s_pos = _component_end(tok, path_end);
+    }
+    return 0; /* yay :) */
+}
+
+/* skip slashes, returns the length of the next path component at *pos */
+static size_t _next_component(const char **pos)
+{
+    const char *start = *pos;
+    while (*start == '/') {
+        start += 1;
+    }
+    const char *end = start;
+    while ((*end != '\0') && (*end != '/')) {
+        end += 1;
+    }
+    *pos = start;
+    return end - start;
+}
+
+int db_get_many(const db_node_t *base, const char *const *paths, size_t num,
+                db_result_t *results)
+{
+    assert(paths);
+    assert(results);
+    /* stack[d]: node reached by the first d components of the last path */
+    db_node_t stack[CONFIG_DCA_PATH_DEPTH_MAX + 1];
+    /* components of the last path that stack[] is valid for */
+    const char *comp[CONFIG_DCA_PATH_DEPTH_MAX];
+    size_t comp_len[CONFIG_DCA_PATH_DEPTH_MAX];
+    unsigned depth = 0;
+    int found = 0;
+
+    if (base) {
+        db_node_copy(&stack[0], base);
+    }
+    else {
+        db_get_root(&stack[0]);
+    }
+    for (size_t i = 0; i < num; i++) {
+        db_result_t *result = &results[i];
+        const char *pos = paths[i];
+        unsigned d = 0;
+        size_t len;
+        int r = 0;
+
+        assert(pos);
+        while ((len = _next_component(&pos)) > 0) {
+            if (d == CONFIG_DCA_PATH_DEPTH_MAX) {
+                r = -ENAMETOOLONG;
+                break;
+            }
+            if ((d >= depth) || (comp_len[d] != len) ||
+                (memcmp(comp[d], pos, len) != 0)) {
+                /* not shared with the last path, resolve from here */
+                depth = d;
+                r = db_node_find_child(&stack[d], pos, len, &stack[d + 1]);
+                if (r < 0) {
+                    break;
+                }
+                comp[d] = pos;
+                comp_len[d] = len;
+                depth = d + 1;
+            }
+            d++;
+            pos += len;
+        }
+        DEBUG("db_get_many(): %s -> %d\n", paths[i], r);
+        result->res = r;
+        if (r < 0) {
+            result->type = db_node_type_null;
+            db_node_set_null(&result->node);
+            continue;
+        }
+        db_node_copy(&result->node, &stack[d]);
+        result->type = db_node_get_type(&result->node);
+        if (result->type == db_node_type_int) {
+            result->value.i = db_node_get_int_value(&result->node);
         }
-        s_pos = strchr(tok, '/');
-        if (s_pos == NULL) {
-            s_pos = path_end;
+        else if (result->type == db_node_type_float) {
+            result->value.f = db_node_get_float_value(&result->node);
+        }
+        found++;
+    }
+    return found;
+}
+
+/* fallback for nodes without find_child_fn: compare every child's name */
+static int _find_child_linear(const db_node_t *node, const char *name, size_t len,
+                              db_node_t *child)
+{
+    char name_buf[DB_NODE_NAME_MAX];
+    db_node_t iter;
+
+    if (len >= DB_NODE_NAME_MAX) {
+        return -ENOENT;
+    }
+    db_node_copy(&iter, node);
+    while (1) {
+        db_node_get_next_child(&iter, child);
+        if (db_node_is_null(child)) {
+            /* we have searched through all entries */
+            return -ENOENT;
+        }
+        db_node_get_name(child, name_buf);
+        /* the name must match completely, not only its first len bytes */
+        if ((memcmp(name, name_buf, len) == 0) && (name_buf[len] == '\0')) {
+            return 0;
         }
     }
-    return 0; /* yay :) */
 }
 
 char *db_node_get_name(const db_node_t *node, char name[DB_NODE_NAME_MAX])
@@ -122,6 +246,21 @@ int db_node_get_next_child(db_node_t *node, db_node_t *next_child)
     return node->ops->get_next_child_fn(node, next_child);
 }
 
+int db_node_find_child(const db_node_t *node, const char *name, size_t len,
+                       db_node_t *child)
+{
+    assert(node);
+    assert(name);
+    assert(child);
+    if (node->ops->find_child_fn) {
+        int r = node->ops->find_child_fn(node, name, len, child);
+        if (r != -ENOTSUP) {
+            return r;
+        }
+    }
+    return _find_child_linear(node, name, len, child);
+}
+
 int db_node_get_next(db_node_t *node, db_node_t *next)
 {
     assert(node);
@@ -167,6 +306,28 @@ size_t db_node_get_str_value(const db_node_t *node, char *value, size_t bufsize)
     return node->ops->get_str_value_fn(node, value, bufsize);
 }
 
+static size_t _int_to_str(int32_t val, char *buf, size_t bufsize)
+{
+    size_t size = fmt_s32_dec(NULL, val);
+    if (size > bufsize - 1) {
+        strncpy(buf, "---", bufsize);
+        return 3u;
+    }
+    return fmt_s32_dec(buf, val);
+}
+
+static size_t _float_to_str(float val, char *buf, size_t bufsize)
+{
+    /* TODO: according to doc this func uses up to 2.4kB code,
+       it should become optional in some way. */
+    size_t size = fmt_float(NULL, val, FLOAT_PRESCISION);
+    if (size > bufsize - 1) {
+        strncpy(buf, "---", bufsize);
+        return 3u;
+    }
+    return fmt_float(buf, val, FLOAT_PRESCISION);
+}
+
 int db_node_value_to_str(const db_node_t *node, char *buf, size_t bufsize)
 {
     assert(node);
@@ -175,33 +336,11 @@ int db_node_value_to_str(const db_node_t *node, char *buf, size_t bufsize)
 
     switch (db_node_get_type(node)) {
     case db_node_type_int:
-    {
-        int32_t val = db_node_get_int_value(node);
-        size = fmt_s32_dec(NULL, val);
-        if (size > bufsize - 1) {
-            strncpy(buf, "---", bufsize);
-            size = 3u;
-        }
-        else {
-            fmt_s32_dec(buf, val);
-        }
-    }
-    break;
+        size = _int_to_str(db_node_get_int_value(node), buf, bufsize);
+        break;
     case db_node_type_float:
-    {
-        float val = db_node_get_float_value(node);
-        /* TODO: according to doc this func uses up to 2.4kB code,
-           it should become optional in some way. */
-        size = fmt_float(NULL, val, FLOAT_PRESCISION);
-        if (size > bufsize - 1) {
-            strncpy(buf, "---", bufsize);
-            size = 3u;
-        }
-        else {
-            fmt_float(buf, val, FLOAT_PRESCISION);
-        }
-    }
-    break;
+        size = _float_to_str(db_node_get_float_value(node), buf, bufsize);
+        break;
     case db_node_type_str:
         size = db_node_get_str_value(node, buf, bufsize - 1);
         break;
@@ -213,3 +352,28 @@ int db_node_value_to_str(const db_node_t *node, char *buf, size_t bufsize)
     size += 1;
     return (int)size;
 }
+
+int db_result_to_str(const db_result_t *result, char *buf, size_t bufsize)
+{
+    assert(result);
+    assert(bufsize >= 4);
+    size_t size = 0u;
+
+    switch (result->type) {
+    case db_node_type_int:
+        size = _int_to_str(result->value.i, buf, bufsize);
+        break;
+    case db_node_type_float:
+        size = _float_to_str(result->value.f, buf, bufsize);
+        break;
+    case db_node_type_str:
+        size = db_node_get_str_value(&result->node, buf, bufsize - 1);
+        break;
+    default:
+        DEBUG("db_result_to_str: no value, res %d\n", result->res);
+        return -EFAULT;
+    }
+    buf[size] = '\0';
+    size += 1;
+    return (int)size;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/db_walk.h"
+#include "doriot_dca/db.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/* pass the ENTER or LEAF event of node to the sink */
+static int _visit(db_node_t *node, uint8_t depth, char *name,
+                  db_walk_sink_t sink, void *arg)
+{
+    db_walk_event_t ev = {
+        .depth = depth,
+        .type = db_node_get_type(node),
+        .node = node,
+        .name = db_node_get_name(node, name),
+    };
+    ev.event = (ev.type == db_node_type_inner) ? DB_WALK_ENTER : DB_WALK_LEAF;
+    int r = sink(&ev, arg);
+    return (r < 0) ? r : (ev.event == DB_WALK_ENTER);
+}
+
+int db_walk(const db_node_t *base, unsigned max_depth, db_walk_sink_t sink,
+            void *arg)
+{
+    assert(sink);
+    /* stack[d]: the inner node whose children are visited at depth d + 1 */
+    db_node_t stack[CONFIG_DCA_PATH_DEPTH_MAX + 1];
+    char name[DB_NODE_NAME_MAX];
+    int r;
+
+    if (max_depth > CONFIG_DCA_PATH_DEPTH_MAX) {
+        max_depth = CONFIG_DCA_PATH_DEPTH_MAX;
+    }
+    if (base) {
+        db_node_copy(&stack[0], base);
+    }
+    else {
+        db_get_root(&stack[0]);
+    }
+    r = _visit(&stack[0], 0, name, sink, arg);
+    if (r <= 0) {
+        return r;
+    }
+
+    unsigned depth = 0;
+    for (;;) {
+        int more = 0;
+        if (depth < max_depth) {
+            db_node_get_next_child(&stack[depth], &stack[depth + 1]);
+            more = !db_node_is_null(&stack[depth + 1]);
+        }
+        if (more) {
+            r = _visit(&stack[depth + 1], depth + 1, name, sink, arg);
+            if (r < 0) {
+                return r;
+            }
+            /* descend into inner nodes */
+            depth += r;
+            continue;
+        }
+        db_walk_event_t ev = {
+            .event = DB_WALK_LEAVE,
+            .depth = depth,
+            .type = db_node_type_inner,
+            .node = &stack[depth],
+            .name = NULL,
+        };
+        r = sink(&ev, arg);
+        if (r < 0) {
+            return r;
+        }
+        if (depth == 0) {
+            return 0;
+        }
+        depth--;
+    }
+}
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+#
+"""
+Generate a minimal perfect hash over the static paths of the DCA database.
+
+The static part of the database (db_index[] and the *_static_entries[] and
+*_dynamic_entries[] tables in db.c) is fixed at build time. This script reads
+those tables and emits a header with a hash-and-displace table, so that
+db_fl.c can resolve a static path with one hash and one strcmp().
+
+Rows and branches that are enclosed in #if/#ifdef blocks keep their guards in
+the generated table. The hash is built over all of them, disabled entries
+simply leave an empty slot behind.
+
+usage: gen_db_phash.py <db.c> <output header>
+"""
+
+import re
+import sys
+
+# must match _db_phash() in db_fl.c
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+DISP_MAX = 255
+
+
+def fnv1a(seed, key):
+    h = FNV_OFFSET ^ seed
+    for c in key.encode():
+        h ^= c
+        h = (h * FNV_PRIME) & 0xffffffff
+    return h
+
+
+class Parser:
+    """Collects table rows from db.c together with their #if guards"""
+
+    TABLE_RE = re.compile(r'db_fl_(static|dynamic)_entry_t\s+_(\w+)_entries\s*\[\]')
+    ROW_RE = re.compile(r'^\s*\{\s*DB_STR\((\w+)\)')
+    BRANCH_RE = re.compile(r'\.branch_name\s*=\s*DB_STR\((\w+)\)')
+    STATIC_RE = re.compile(r'\.static_entries\s*=\s*(\w+)')
+    DYNAMIC_RE = re.compile(r'\.dynamic_entries\s*=\s*(\w+)')
+
+    def __init__(self, lines):
+        self.guards = []
+        self.tables = {}    # table name -> [(entry name, guards)]
+        self.branches = []  # [(branch name, guards, static table, dynamic table)]
+        self._parse(lines)
+
+    def _preproc(self, line):
+        m = re.match(r'\s*#\s*(\w+)\s*(.*)', line)
+        if not m:
+            return False
+        directive, expr = m.group(1), re.sub(r'/\*.*?\*/', '', m.group(2)).strip()
+        if directive == 'if':
+            self.guards.append(expr)
+        elif directive == 'ifdef':
+            self.guards.append('defined(%s)' % expr)
+        elif directive == 'ifndef':
+            self.guards.append('!defined(%s)' % expr)
+        elif directive == 'endif':
+            self.guards.pop()
+        elif directive in ('else', 'elif'):
+            sys.exit('gen_db_phash.py: #%s is not supported in db.c tables' % directive)
+        return True
+
+    def _parse(self, lines):
+        table = None
+        branch = None
+        for line in lines:
+            if self._preproc(line):
+                continue
+            m = self.TABLE_RE.search(line)
+            if m:
+                table = '_%s_entries' % m.group(2)
+                self.tables[table] = []
+                continue
+            if 'db_fl_entry_t db_index[]' in line:
+                table = 'db_index'
+                continue
+            if table is None:
+                continue
+            if re.match(r'^\s*\};', line):
+                table = None
+                continue
+            if table == 'db_index':
+                m = self.BRANCH_RE.search(line)
+                if m:
+                    branch = [m.group(1), list(self.guards), None, None]
+                    self.branches.append(branch)
+                m = self.STATIC_RE.search(line)
+                if m and branch:
+                    branch[2] = m.group(1)
+                m = self.DYNAMIC_RE.search(line)
+                if m and branch:
+                    branch[3] = m.group(1)
+            else:
+                m = self.ROW_RE.match(line)
+                if m:
+                    self.tables[table].append((m.group(1), list(self.guards)))
+
+
+def collect_keys(parser):
+    """Return [(path, fl enum, sub_idx, guards)]"""
+    keys = []
+    for name, guards, static, dynamic in parser.branches:
+        fl = 'DB_FL_%s' % name.upper()
+        keys.append((name, fl, 'DB_FL_SUB_NONE', guards))
+        rows = parser.tables.get(static, []) + parser.tables.get(dynamic, [])
+        guarded = False
+        for sub_idx, (entry, entry_guards) in enumerate(rows):
+            # sub_idx is only valid if guards drop trailing rows
+            if guarded and entry_guards == guards:
+                sys.exit('gen_db_phash.py: guarded row before "%s" in branch "%s"'
+                         % (entry, name))
+            guarded = guarded or entry_guards != guards
+            keys.append(('%s/%s' % (name, entry), fl, str(sub_idx),
+                         guards + [g for g in entry_guards if g not in guards]))
+    return keys
+
+
+def build(keys):
+    """Hash-and-displace: returns (displacements, slot for every key)"""
+    n = len(keys)
+    buckets = [[] for _ in range(n)]
+    for i, key in enumerate(keys):
+        buckets[fnv1a(0, key[0]) % n].append(i)
+    disp = [0] * n
+    slots = [None] * n
+    taken = set()
+    for b in sorted(range(n), key=lambda b: -len(buckets[b])):
+        if not buckets[b]:
+            continue
+        for d in range(1, DISP_MAX + 1):
+            pos = [fnv1a(d, keys[i][0]) % n for i in buckets[b]]
+            if len(set(pos)) == len(pos) and not taken.intersection(pos):
+                break
+        else:
+            sys.exit('gen_db_phash.py: no displacement found')
+        disp[b] = d
+        for i, p in zip(buckets[b], pos):
+            slots[i] = p
+            taken.add(p)
+    return disp, slots
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1]) as f:
+        parser = Parser(f.readlines())
+    keys = collect_keys(parser)
+    disp, slots = build(keys)
+
+    out = []
+    out.append('/* generated by dist/gen_db_phash.py from db.c, do not edit */')
+    out.append('#define DB_PHASH_NUM_KEYS (%dU)' % len(keys))
+    out.append('')
+    out.append('static const uint8_t _db_phash_disp[DB_PHASH_NUM_KEYS] = {')
+    for i in range(0, len(disp), 12):
+        out.append('    ' + ', '.join(str(d) for d in disp[i:i + 12]) + ',')
+    out.append('};')
+    out.append('')
+    out.append('static const db_phash_entry_t _db_phash_entries[DB_PHASH_NUM_KEYS] = {')
+    for (path, fl, sub_idx, guards), slot in sorted(zip(keys, slots), key=lambda k: k[1]):
+        if guards:
+            out.append('#if ' + ' && '.join('(%s)' % g for g in guards))
+        out.append('    [%d] = { "%s", %s, %s },' % (slot, path, fl, sub_idx))
+        if guards:
+            out.append('#endif')
+    out.append('};')
+    with open(sys.argv[2], 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @file
+ * @brief   Microbenchmark of db_find_node_by_path() on static leaves
+ *
+ * Every path is resolved BENCH_ROUNDS times by
+ *  - scan:  the walk db_find_node_by_path() did originally, comparing the
+ *           name of every sibling until one matches,
+ *  - level: one db_node_find_child() per path component,
+ *  - path:  db_find_node_by_path(), which resolves the static part of the
+ *           path with one lookup in the generated perfect hash.
+ * The time per lookup is printed in ns.
+ *
+ *     make BOARD=native all term
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "doriot_dca.h"
+#include "kernel_defines.h"
+#include "xtimer.h"
+
+#define BENCH_ROUNDS (10000U)
+
+typedef int (*_find_fn_t)(const char *path, db_node_t *node);
+
+static const char *const _paths[] = {
+    "/board/name",
+    "/board/nonvolatile",
+    "/runtime/cpu_util",
+    "/runtime/heap",
+    "/dca/cache_misses",
+#if CONFIG_DCA_NETWORK
+    "/network/udp_dropped",
+#endif
+};
+
+/* skip slashes, returns the length of the next path component at *pos */
+static size_t _next_component(const char **pos)
+{
+    const char *start = *pos;
+    while (*start == '/') {
+        start += 1;
+    }
+    const char *end = start;
+    while ((*end != '\0') && (*end != '/')) {
+        end += 1;
+    }
+    *pos = start;
+    return end - start;
+}
+
+static int _find_scan(const char *path, db_node_t *node)
+{
+    char name[DB_NODE_NAME_MAX];
+    db_node_t child;
+    size_t len;
+
+    db_get_root(node);
+    while ((len = _next_component(&path)) > 0) {
+        do {
+            db_node_get_next_child(node, &child);
+            if (db_node_is_null(&child)) {
+                return -ENOENT;
+            }
+            db_node_get_name(&child, name);
+        } while ((strncmp(path, name, len) != 0) || (name[len] != '\0'));
+        db_node_copy(node, &child);
+        path += len;
+    }
+    return 0;
+}
+
+static int _find_level(const char *path, db_node_t *node)
+{
+    db_node_t child;
+    size_t len;
+
+    db_get_root(node);
+    while ((len = _next_component(&path)) > 0) {
+        int r = db_node_find_child(node, path, len, &child);
+        if (r < 0) {
+            return r;
+        }
+        db_node_copy(node, &child);
+        path += len;
+    }
+    return 0;
+}
+
+/* Returns the time per lookup in ns, or a negative errno */
+static int32_t _bench(_find_fn_t find, const char *path, db_node_t *node)
+{
+    uint32_t start = xtimer_now_usec();
+
+    for (unsigned i = 0; i < BENCH_ROUNDS; i++) {
+        int r = find(path, node);
+        if (r < 0) {
+            return r;
+        }
+    }
+    return (int32_t)((uint64_t)(xtimer_now_usec() - start) * 1000U
+                     / BENCH_ROUNDS);
+}
+
+static int _same(const db_node_t *a, const db_node_t *b)
+{
+    char name_a[DB_NODE_NAME_MAX];
+    char name_b[DB_NODE_NAME_MAX];
+
+    return (db_node_get_type(a) == db_node_get_type(b)) &&
+           (strcmp(db_node_get_name(a, name_a),
+                   db_node_get_name(b, name_b)) == 0);
+}
+
+int main(void)
+{
+    int failed = 0;
+
+    printf("db lookup benchmark, %u rounds, ns per lookup\n", BENCH_ROUNDS);
+    printf("%-24s %8s %8s %8s\n", "path", "scan", "level", "path");
+    for (unsigned i = 0; i < ARRAY_SIZE(_paths); i++) {
+        db_node_t scan, level, path;
+        int32_t t_scan = _bench(_find_scan, _paths[i], &scan);
+        int32_t t_level = _bench(_find_level, _paths[i], &level);
+        int32_t t_path = _bench(db_find_node_by_path, _paths[i], &path);
+
+        if ((t_scan < 0) || (t_level < 0) || (t_path < 0) ||
+            !_same(&scan, &path) || !_same(&level, &path)) {
+            printf("%-24s not resolved to the same node\n", _paths[i]);
+            failed = 1;
+            continue;
+        }
+        printf("%-24s %8" PRId32 " %8" PRId32 " %8" PRId32 "\n", _paths[i],
+               t_scan, t_level, t_path);
+    }
+    puts(failed ? "FAILURE" : "SUCCESS");
+    return 0;
+}
@@ -33,6 +33,12 @@ int main(void)
 #ifdef CONFIG_DCA_NETWORK
     db_start_udp_server();
 #endif /* CONFIG_DCA_NETWORK */
+#ifdef CONFIG_DCA_SAMPLER
+    db_start_sampler();
+#endif /* CONFIG_DCA_SAMPLER */
+#ifdef CONFIG_DCA_QOS_SCHED
+    db_start_qos_sched();
+#endif /* CONFIG_DCA_QOS_SCHED */
     msg_init_queue(_main_msg_queue, MAIN_QUEUE_SIZE);
     char line_buf[SHELL_DEFAULT_BUFSIZE];
 
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @file
+ * @brief   Stress test of the seqlock read path
+ *
+ * A writer and several readers of the same priority yield in the middle of
+ * every copy, so that reads overlap writes all the time, and a reader of
+ * higher priority woken by a timer preempts them at any point. Every value
+ * a reader accepts must be consistent: all words of the test value equal,
+ * throughput and throughput_rx of the neighbor table entry equal. The
+ * result is printed after STRESS_DURATION_US.
+ *
+ *     make BOARD=native all term
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "doriot_dca/neighbor_table.h"
+#include "doriot_dca/seqlock.h"
+#include "thread.h"
+#include "xtimer.h"
+
+#define STRESS_WORDS (8U)
+#define STRESS_READERS (3U)
+#define STRESS_DURATION_US (5U * US_PER_SEC)
+/* not a divisor of the scheduling of the other threads */
+#define STRESS_TIMER_US (97U)
+/* below main, which only waits */
+#define STRESS_PRIO (THREAD_PRIORITY_MAIN + 1)
+
+typedef struct {
+    uint32_t reads;
+    /* reads repeated because a write overlapped */
+    uint32_t retries;
+    /* values accepted although they were torn, must stay 0 */
+    uint32_t torn;
+} _stats_t;
+
+static seqlock_t _lock = SEQLOCK_INIT;
+static uint32_t _value[STRESS_WORDS];
+static volatile bool _stop = false;
+
+/* the readers of STRESS_PRIO, then the timed one */
+static _stats_t _stats[STRESS_READERS + 1];
+static char _stacks[STRESS_READERS + 2][THREAD_STACKSIZE_DEFAULT];
+static const ipv6_addr_t _addr = { .u8 = { 0xfe, 0x80, [15] = 0x01 } };
+
+static void _copy(uint32_t *dst, const uint32_t *src, unsigned num)
+{
+    for (unsigned i = 0; i < num; i++) {
+        dst[i] = src[i];
+    }
+}
+
+/* Read the test value, yielding halfway through every other try if yield is
+ * set: always yielding would keep the readers in lockstep with the writer,
+ * retrying forever */
+static void _read_value(_stats_t *stats, bool yield)
+{
+    uint32_t copy[STRESS_WORDS];
+    unsigned seq;
+    int retry;
+
+    do {
+        seq = seqlock_read_begin(&_lock);
+        _copy(copy, _value, STRESS_WORDS / 2);
+        if (yield && ((stats->reads + stats->retries) & 1)) {
+            thread_yield();
+        }
+        _copy(&copy[STRESS_WORDS / 2], &_value[STRESS_WORDS / 2],
+              STRESS_WORDS - STRESS_WORDS / 2);
+        retry = seqlock_read_retry(&_lock, seq);
+        if (retry) {
+            stats->retries++;
+        }
+    } while (retry);
+    stats->reads++;
+    for (unsigned i = 1; i < STRESS_WORDS; i++) {
+        if (copy[i] != copy[0]) {
+            stats->torn++;
+            break;
+        }
+    }
+}
+
+/* Read the entry of _addr through the neighbor table's own read path */
+static void _read_table(_stats_t *stats)
+{
+    neighbor_entry_t entry;
+    int slot = neighbor_table_next(0);
+
+    if ((slot < 0) || (neighbor_table_get(slot, &entry) < 0)) {
+        return;
+    }
+    stats->reads++;
+    if (entry.throughput != entry.throughput_rx) {
+        stats->torn++;
+    }
+}
+
+static void *_writer(void *arg)
+{
+    (void)arg;
+    uint32_t n = 0;
+
+    while (!_stop) {
+        n++;
+        seqlock_write_begin(&_lock);
+        for (unsigned i = 0; i < STRESS_WORDS; i++) {
+            if (i == STRESS_WORDS / 2) {
+                /* the readers find the write in progress */
+                thread_yield();
+            }
+            _value[i] = n;
+        }
+        seqlock_write_end(&_lock);
+        neighbor_table_update_throughput(&_addr, n, n);
+        thread_yield();
+    }
+    return NULL;
+}
+
+static void *_reader(void *arg)
+{
+    _stats_t *stats = arg;
+
+    while (!_stop) {
+        _read_value(stats, true);
+        _read_table(stats);
+    }
+    return NULL;
+}
+
+static void *_timed_reader(void *arg)
+{
+    _stats_t *stats = arg;
+    xtimer_ticks32_t last = xtimer_now();
+
+    while (!_stop) {
+        xtimer_periodic_wakeup(&last, STRESS_TIMER_US);
+        _read_value(stats, false);
+        _read_table(stats);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    _stats_t total = { 0 };
+
+    puts("seqlock stress test");
+    thread_create(_stacks[0], sizeof(_stacks[0]), STRESS_PRIO,
+                  THREAD_CREATE_STACKTEST, _writer, NULL, "writer");
+    for (unsigned i = 0; i < STRESS_READERS; i++) {
+        thread_create(_stacks[i + 1], sizeof(_stacks[i + 1]), STRESS_PRIO,
+                      THREAD_CREATE_STACKTEST, _reader, &_stats[i], "reader");
+    }
+    thread_create(_stacks[STRESS_READERS + 1],
+                  sizeof(_stacks[STRESS_READERS + 1]), THREAD_PRIORITY_MAIN - 1,
+                  THREAD_CREATE_STACKTEST, _timed_reader,
+                  &_stats[STRESS_READERS], "timed reader");
+
+    xtimer_usleep(STRESS_DURATION_US);
+    _stop = true;
+    /* let the threads see _stop */
+    xtimer_usleep(10 * STRESS_TIMER_US);
+
+    for (unsigned i = 0; i <= STRESS_READERS; i++) {
+        printf("reader %u: %" PRIu32 " reads, %" PRIu32 " retries, %" PRIu32
+               " torn\n", i, _stats[i].reads, _stats[i].retries,
+               _stats[i].torn);
+        total.reads += _stats[i].reads;
+        total.retries += _stats[i].retries;
+        total.torn += _stats[i].torn;
+    }
+    /* without retries, the test did not overlap reads and writes */
+    puts(((total.torn == 0) && (total.retries > 0) && (total.reads > 0))
+         ? "SUCCESS" : "FAILURE");
+    return 0;
+}
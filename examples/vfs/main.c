@@ -235,6 +235,12 @@ int main(void)
 #endif /* defined(USE_DCAFS) */
 
     db_start_udp_server();
+#ifdef CONFIG_DCA_SAMPLER
+    db_start_sampler();
+#endif /* CONFIG_DCA_SAMPLER */
+#ifdef CONFIG_DCA_QOS_SCHED
+    db_start_qos_sched();
+#endif /* CONFIG_DCA_QOS_SCHED */
     msg_init_queue(_main_msg_queue,MAIN_QUEUE_SIZE);
     char line_buf[SHELL_DEFAULT_BUFSIZE];
     shell_run(shell_commands, line_buf, SHELL_DEFAULT_BUFSIZE);
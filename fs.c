@@ -37,6 +37,11 @@ static int dcafs_open(vfs_file_t *filp, const char *name, int flags, mode_t mode
 static ssize_t dcafs_read(vfs_file_t *filp, void *dest, size_t nbytes);
 static ssize_t dcafs_write(vfs_file_t *filp, const void *src, size_t nbytes);
 
+/* Snapshot and name table files, see snapshot.h */
+static int dcafs_blob_fstat(vfs_file_t *filp, struct stat *buf);
+static off_t dcafs_blob_lseek(vfs_file_t *filp, off_t off, int whence);
+static ssize_t dcafs_blob_read(vfs_file_t *filp, void *dest, size_t nbytes);
+
 /* Directory operations */
 static int dcafs_opendir(vfs_DIR *dirp, const char *dirname, const char *abs_path);
 static int dcafs_readdir(vfs_DIR *dirp, vfs_dirent_t *entry);
@@ -59,6 +64,23 @@ static const vfs_file_ops_t dcafs_file_ops = {
     .write = dcafs_write,
 };
 
+/* dcafs_open switches to these for snapshot and name table files */
+static const vfs_file_ops_t dcafs_blob_ops = {
+    .close = dcafs_close,
+    .fstat = dcafs_blob_fstat,
+    .lseek = dcafs_blob_lseek,
+    .open  = dcafs_open,
+    .read  = dcafs_blob_read,
+    .write = dcafs_write,
+};
+
+/* private data of snapshot and name table files */
+typedef struct {
+    /* sequence number of the snapshot, 0 for the name table */
+    uint32_t seq;
+    uint32_t size;
+} _dcafs_blob_t;
+
 static const vfs_dir_ops_t dcafs_dir_ops = {
     .opendir = dcafs_opendir,
     .readdir = dcafs_readdir,
@@ -81,6 +103,15 @@ const vfs_file_system_t dcafs_file_system = {
  */
 static void _dcafs_write_stat(const db_node_t *node, struct stat *restrict buf);
 
+/**
+ * @internal
+ * @brief Fill a file information struct for a snapshot or name table file
+ *
+ * @param[in]  size   file size
+ * @param[out] buf    output buffer
+ */
+static void _dcafs_write_blob_stat(size_t size, struct stat *restrict buf);
+
 static int dcafs_mount(vfs_mount_t *mountp)
 {
     (void) mountp;
@@ -108,6 +139,15 @@ static int dcafs_stat(vfs_mount_t *mountp, const char *restrict name, struct sta
     }
     int ret;
     db_node_t node;
+    if (strcmp(name, "/" DB_SNAPSHOT_STRTAB_NAME) == 0) {
+        _dcafs_write_blob_stat(sizeof(db_fl_strtab), buf);
+        return 0;
+    }
+    if (db_snapshot_find(name, &node) == 0) {
+        /* the size is not known before the snapshot is taken */
+        _dcafs_write_blob_stat(0, buf);
+        return 0;
+    }
     ret = db_find_node_by_path(name, &node);
     if(ret < 0) {
         DEBUG("dcafs_stat: Not found :(\n");
@@ -194,6 +234,23 @@ static int dcafs_open(vfs_file_t *filp, const char *name, int flags, mode_t mode
     }
     int ret;
     db_node_t node;
+    _dcafs_blob_t *blob = (_dcafs_blob_t *) filp->private_data.buffer;
+    if (strcmp(name, "/" DB_SNAPSHOT_STRTAB_NAME) == 0) {
+        blob->seq = 0;
+        blob->size = sizeof(db_fl_strtab);
+        filp->f_op = &dcafs_blob_ops;
+        return 0;
+    }
+    if (db_snapshot_find(name, &node) == 0) {
+        ret = db_snapshot_take(&node, &blob->seq);
+        if (ret < 0) {
+            DEBUG("dcafs_open: snapshot failed :(\n");
+            return ret;
+        }
+        blob->size = ret;
+        filp->f_op = &dcafs_blob_ops;
+        return 0;
+    }
     ret = db_find_node_by_path(name, &node);
     if(ret < 0) {
         DEBUG("dcafs_open: Not found :(\n");
@@ -258,6 +315,61 @@ static ssize_t dcafs_write(vfs_file_t *filp, const void *src, size_t nbytes)
     return -EBADF;
 }
 
+static int dcafs_blob_fstat(vfs_file_t *filp, struct stat *buf)
+{
+    if (buf == NULL) {
+        return -EFAULT;
+    }
+    _dcafs_blob_t *blob = (_dcafs_blob_t *) filp->private_data.buffer;
+    _dcafs_write_blob_stat(blob->size, buf);
+    return 0;
+}
+
+static off_t dcafs_blob_lseek(vfs_file_t *filp, off_t off, int whence)
+{
+    _dcafs_blob_t *blob = (_dcafs_blob_t *) filp->private_data.buffer;
+    switch (whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            off += filp->pos;
+            break;
+        case SEEK_END:
+            off += blob->size;
+            break;
+        default:
+            return -EINVAL;
+    }
+    if (off < 0) {
+        return -EINVAL;
+    }
+    filp->pos = off;
+    return off;
+}
+
+static ssize_t dcafs_blob_read(vfs_file_t *filp, void *dest, size_t nbytes)
+{
+    _dcafs_blob_t *blob = (_dcafs_blob_t *) filp->private_data.buffer;
+    if ((size_t)filp->pos >= blob->size) {
+        return 0;
+    }
+    if (nbytes > (blob->size - (size_t)filp->pos)) {
+        nbytes = blob->size - filp->pos;
+    }
+    if (blob->seq == 0) {
+        memcpy(dest, (const uint8_t *)&db_fl_strtab + filp->pos, nbytes);
+    }
+    else {
+        /* the shared buffer may hold a newer snapshot by now */
+        ssize_t res = db_snapshot_read(&blob->seq, filp->pos, dest, nbytes);
+        if (res < 0) {
+            return res;
+        }
+    }
+    filp->pos += nbytes;
+    return nbytes;
+}
+
 static int dcafs_opendir(vfs_DIR *dirp, const char *dirname, const char *abs_path)
 {
     (void) abs_path;
@@ -312,3 +424,13 @@ static void _dcafs_write_stat(const db_node_t *node, struct stat *restrict buf)
     buf->st_blocks = db_node_get_size(node);
     buf->st_blksize = sizeof(uint8_t);
 }
+
+static void _dcafs_write_blob_stat(size_t size, struct stat *restrict buf)
+{
+    memset(buf, 0, sizeof(*buf));
+    buf->st_nlink = 1;
+    buf->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+    buf->st_size = size;
+    buf->st_blocks = size;
+    buf->st_blksize = sizeof(uint8_t);
+}
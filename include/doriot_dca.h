@@ -20,7 +20,11 @@
 #include "doriot_dca/db.h"
 #include "doriot_dca/db_node.h"
 #include "doriot_dca/udp_throughput.h"
+#include "doriot_dca/qos_sched.h"
 #include "doriot_dca/coap.h"
+#include "doriot_dca/sampler.h"
+#include "doriot_dca/snapshot.h"
+#include "doriot_dca/db_walk.h"
 
 /** @} */
 #endif /* DORIOT_DCA_H */
@@ -25,8 +25,25 @@
 extern "C" {
 #endif
 
+/**
+ * Indices of the firstlevel branches in db_index[].
+ * dist/gen_db_phash.py derives these names from the branch names.
+ */
+enum {
+    DB_FL_BOARD,
+    DB_FL_RUNTIME,
+#if CONFIG_DCA_NETWORK
+    DB_FL_NETWORK,
+#endif /* CONFIG_DCA_NETWORK */
+#if CONFIG_DCA_SAUL
+    DB_FL_SAUL,
+#endif /* CONFIG_DCA_SAUL */
+    DB_FL_DCA,
+    DB_FL_NUMOF
+};
+
 /** This is the DCA database description */
-extern db_fl_entry_t db_index[];
+extern const db_fl_entry_t db_index[];
 
 /** Return the number of elements in db_index */
 size_t db_get_num_fl_nodes(void);
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Value cache for expensive db entries
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * A cache entry holds the last value of a db entry and the time it was
+ * computed. Entries with a max-age (TTL) are served from the cache until
+ * they are older than that. Each cache entry is protected by the seqlock
+ * of the store it is part of, so readers never block each other.
+ */
+#ifndef DORIOT_DCA_DB_CACHE_H
+#define DORIOT_DCA_DB_CACHE_H
+
+#include "doriot_dca/db_node.h"
+#include "doriot_dca/seqlock.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default max-age of stack usage measurements in ms, up to 65535, 0: not
+ * cached */
+#ifndef CONFIG_DCA_STACK_USED_TTL_MS
+#define CONFIG_DCA_STACK_USED_TTL_MS 1000
+#endif
+
+typedef struct {
+    db_value_t value;
+    /** xtimer_now_usec() when value was computed, 0 if empty */
+    uint32_t time;
+} db_cache_entry_t;
+
+/**
+ * Copy the cached value if it is at most max_age us old and count a hit.
+ * Returns 0 on a hit, -ENODATA (and counts a miss) otherwise.
+ */
+int db_cache_get(seqlock_t *lock, const db_cache_entry_t *entry,
+                 uint32_t max_age, db_value_t *value);
+
+/** Store a freshly computed value */
+void db_cache_put(seqlock_t *lock, db_cache_entry_t *entry, db_value_t value);
+
+/** Return number of reads served from a cache */
+int32_t db_cache_get_hits(void);
+/** Return number of reads that had to compute the value */
+int32_t db_cache_get_misses(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
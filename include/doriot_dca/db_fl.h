@@ -17,43 +17,126 @@
 #ifndef DORIOT_DCA_DB_FL_H
 #define DORIOT_DCA_DB_FL_H
 
+#include "doriot_dca/db_cache.h"
 #include "doriot_dca/db_node.h"
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Names of the firstlevel branches and their entries. Each distinct name is
+ * interned once in db_fl_strtab, tables refer to it by its offset (DB_STR).
+ */
+#define DB_FL_STRINGS(X) \
+    X(board) X(name) X(mcu) X(ram) X(clock) X(nonvolatile) \
+    X(runtime) X(cpu_load) X(cpu_util) X(num_processes) X(stack_used) \
+    X(heap) X(ps) \
+    X(network) X(num_ifaces) X(netif) X(neighbors) X(neighbors_evicted) \
+    X(neighbors_expired) X(udp_sessions) X(udp_rejected) X(udp_expired) \
+    X(udp_dropped) \
+    X(saul) X(num_sensors) X(num_actuators) X(devices) \
+    X(dca) X(sampler_runs) X(sampler_last_us) X(sampler_util) \
+    X(cache_hits) X(cache_misses)
+
+#define DB_FL_STRTAB_FIELD(s) char s[sizeof(#s)];
+
+/** Interned string table, all names concatenated with their '\0' */
+typedef struct {
+    DB_FL_STRINGS(DB_FL_STRTAB_FIELD)
+} db_fl_strtab_t;
+
+extern const db_fl_strtab_t db_fl_strtab;
+
+/** Reference to a name in db_fl_strtab */
+typedef uint16_t db_str_t;
+
+/** Get the reference to an interned name, e.g. DB_STR(cpu_util) */
+#define DB_STR(s) ((db_str_t)offsetof(db_fl_strtab_t, s))
+
+/** Resolve a reference to an interned name */
+static inline const char *db_str(db_str_t str)
+{
+    return (const char *)&db_fl_strtab + str;
+}
+
+/** Reference to a name that is not interned */
+#define DB_STR_NONE ((db_str_t)UINT16_MAX)
+
+/** Find the reference to an interned name, DB_STR_NONE if there is none */
+db_str_t db_str_find(const char *name);
+
 typedef struct {
-    char name[DB_NODE_NAME_MAX];
+    /** Entry (node) name */
+    db_str_t name;
     void (*get_node_fn)(db_node_t *node);
+    /** Collects the values of the subtree for the sampler, may be NULL */
+    void (*sample_fn)(void);
 } db_fl_dynamic_entry_t;
 
 typedef struct {
     /** Entry (node) name */
-    char name[DB_NODE_NAME_MAX];
-    /** Entry (node) type */
-    db_node_type_t type;
+    db_str_t name;
+    /** Entry (node) type, a db_node_type_t */
+    uint8_t type;
     /** Entry (node) value function */
     void (*get_value_fn)(void);
+    /** Max-age of a cached value in ms, 0: computed on every read */
+    uint16_t ttl;
 } db_fl_static_entry_t;
 
 typedef struct {
     /** Name of the top node of the branch. */
-    char branch_name[DB_NODE_NAME_MAX];
+    db_str_t branch_name;
     /** Number of elements in entries */
-	size_t num_static_entries;
-    /** Array of static entries */
-    db_fl_static_entry_t* static_entries;
+    uint8_t num_static_entries;
     /** Number of elements in dynamic_entries */
-	size_t num_dynamic_entries;
+    uint8_t num_dynamic_entries;
+    /** Array of static entries */
+    const db_fl_static_entry_t *static_entries;
     /** Array of dynamic entries */
-	db_fl_dynamic_entry_t* dynamic_entries;
+    const db_fl_dynamic_entry_t *dynamic_entries;
+    /**
+     * Shadow store, one entry per static entry, filled by the sampler and
+     * by reads of entries with a ttl; NULL if neither is used
+     */
+    db_cache_entry_t *shadow;
+    /** Sampling period in ms, 0 if not sampled */
+    uint32_t sample_period;
 } db_fl_entry_t;
 
+#if CONFIG_DCA_SAMPLER
+#define DB_FL_SAMPLE_FN(fn) (fn)
+#else
+#define DB_FL_SAMPLE_FN(fn) NULL
+#endif
+
 void db_new_fl_node(db_node_t *next_child, uint8_t fl_idx);
 
+/** sub_idx of a firstlevel branch itself, in contrast to its entries */
+#define DB_FL_SUB_NONE (0xffU)
+
+/**
+ * Find a branch or one of its static or dynamic entries by its path below
+ * the root, e.g. "runtime/cpu_util" (len bytes, no leading '/'), through the
+ * generated perfect hash. Returns 0 and initializes node on success,
+ * -ENOENT otherwise.
+ */
+int db_fl_find_path(const char *path, size_t len, db_node_t *node);
+
+/**
+ * Read static entry sub_idx of branch fl_idx from the branch's shadow store
+ * if it is at most max_age us old, see db_cache_get()
+ */
+int db_fl_shadow_get(uint8_t fl_idx, uint8_t sub_idx, uint32_t max_age,
+                     db_value_t *value);
+
+/** Store the value of static entry sub_idx of branch fl_idx */
+void db_fl_shadow_put(uint8_t fl_idx, uint8_t sub_idx, db_value_t value);
+
 #ifdef __cplusplus
 }
 #endif
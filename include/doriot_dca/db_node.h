@@ -55,6 +55,12 @@ typedef enum {
 
 typedef struct db_node_ops db_node_ops_t;
 
+/** Value of an int or float node */
+typedef union {
+    int32_t i;
+    float f;
+} db_value_t;
+
 /**
  * @brief A node in the hierarchical database
  *
@@ -62,7 +68,7 @@ typedef struct db_node_ops db_node_ops_t;
  * @param private_data_ptr place to hold implementation-specific data
  */
 typedef struct {
-    db_node_ops_t *ops;
+    const db_node_ops_t *ops;
     union {
         void *ptr;
         uint8_t u8[DB_NODE_PRIVATE_DATA_MAX];
@@ -82,6 +88,13 @@ struct db_node_ops {
     int32_t (*get_int_value_fn) (const db_node_t *node);
     float (*get_float_value_fn) (const db_node_t *node);
     size_t (*get_str_value_fn) (const db_node_t *node, char *value, size_t bufsize);
+    /**
+     * Optional: resolve the child called @p name (not 0-terminated, @p len
+     * bytes) without iterating over all siblings. Return -ENOTSUP to fall
+     * back to a linear search, -ENOENT if there is no such child.
+     */
+    int (*find_child_fn) (const db_node_t *node, const char *name, size_t len,
+                          db_node_t *child);
 };
 
 /** Get a null node instance */
@@ -92,6 +105,35 @@ int db_node_is_null(const db_node_t *node);
 void db_node_copy(db_node_t *dest, const db_node_t *src);
 /** Return a node by its path name, relative to the root. */
 int db_find_node_by_path(const char *path, db_node_t *node);
+/** Like db_find_node_by_path(), for a path of len bytes, not 0-terminated */
+int db_find_node_by_path_len(const char *path, size_t len, db_node_t *node);
+
+/** Maximum number of components of a path passed to db_get_many() */
+#ifndef CONFIG_DCA_PATH_DEPTH_MAX
+#define CONFIG_DCA_PATH_DEPTH_MAX 8
+#endif
+
+/** Result of one path in db_get_many() */
+typedef struct {
+    /** 0, or a negative errno if the path could not be resolved */
+    int res;
+    /** type of the node, db_node_type_null if not resolved */
+    db_node_type_t type;
+    /** value, if the node has db_node_type_int or db_node_type_float */
+    db_value_t value;
+    /** the node, e.g. to read string values */
+    db_node_t node;
+} db_result_t;
+
+/**
+ * Resolve num paths and read their int and float values in one pass.
+ * Paths are relative to base, or to the root if base is NULL. The nodes
+ * of the components a path shares with its predecessor are reused, so
+ * sorted paths need the fewest lookups. Returns the number of paths
+ * resolved; results[i].res tells which ones failed.
+ */
+int db_get_many(const db_node_t *base, const char *const *paths, size_t num,
+                db_result_t *results);
 
 /* Ops wrappers */
 
@@ -99,6 +141,9 @@ int db_find_node_by_path(const char *path, db_node_t *node);
 char *db_node_get_name(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
 /** Iterate through children of node, terminating with a null node */
 int db_node_get_next_child(db_node_t *node, db_node_t *next_child);
+/** Find the child of node called name (len bytes, exact match) */
+int db_node_find_child(const db_node_t *node, const char *name, size_t len,
+                       db_node_t *child);
 /** Get the neighbor of this node. TODO: Not implemented everywhere */
 int db_node_get_next(db_node_t *node, db_node_t *next);
 /** Get type of the node */
@@ -116,6 +161,8 @@ size_t db_node_get_str_value(const db_node_t *node, char *value, size_t bufsize)
 
 /** Convert the node value into a string */
 int db_node_value_to_str(const db_node_t *node, char *buf, size_t bufsize);
+/** Convert a value read by db_get_many() into a string, like db_node_value_to_str */
+int db_result_to_str(const db_result_t *result, char *buf, size_t bufsize);
 
 #ifdef __cplusplus
 }
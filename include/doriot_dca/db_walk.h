@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Streaming walk over a database subtree
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * db_walk() visits a subtree depth-first and passes one event per node to a
+ * sink: DB_WALK_ENTER and DB_WALK_LEAVE around the children of an inner
+ * node, DB_WALK_LEAF for a value. The sink writes the output (shell, CoAP
+ * payload, snapshot buffer) directly, it reads values from the event's node
+ * as it needs them. The walk is iterative: it keeps one node per level and
+ * one name buffer, so its stack usage does not depend on the tree.
+ */
+#ifndef DORIOT_DCA_DB_WALK_H
+#define DORIOT_DCA_DB_WALK_H
+
+#include "doriot_dca/db_node.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    /** An inner node, its children follow */
+    DB_WALK_ENTER,
+    /** All children of an inner node have been visited */
+    DB_WALK_LEAVE,
+    /** A leaf node */
+    DB_WALK_LEAF,
+} db_walk_event_type_t;
+
+typedef struct {
+    db_walk_event_type_t event;
+    /** Depth below the base node of the walk, which has depth 0 */
+    uint8_t depth;
+    db_node_type_t type;
+    /** The node, e.g. to read its value */
+    const db_node_t *node;
+    /** Name of the node, NULL for DB_WALK_LEAVE */
+    const char *name;
+} db_walk_event_t;
+
+/**
+ * Sink for db_walk() events. A negative return value stops the walk, which
+ * returns it.
+ */
+typedef int (*db_walk_sink_t)(const db_walk_event_t *ev, void *arg);
+
+/**
+ * Walk the subtree below base (the root if NULL) down to max_depth, at most
+ * CONFIG_DCA_PATH_DEPTH_MAX. The children of inner nodes at max_depth are
+ * left out. Returns 0, or the negative value returned by the sink.
+ */
+int db_walk(const db_node_t *base, unsigned max_depth, db_walk_sink_t sink,
+            void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
@@ -8,26 +8,124 @@
  *
  * @copyright Copyright (c) 2020
  *
+ * A sweep pings all neighbors in the gnrc neighbor cache at once from the
+ * pinger thread: every DEFAULT_INTERVAL_USEC, one echo request goes out to
+ * each neighbor. The ICMPv6 id carries the sweep generation and the
+ * neighbor's slot in the neighbor table, so replies are matched to their
+ * neighbor without a search and late replies of an earlier sweep are
+ * dropped. The sweep ends when all replies are in or DEFAULT_TIMEOUT_USEC
+ * after the last request, so it takes about as long as pinging the slowest
+ * neighbor alone.
+ *
+ * With CONFIG_DCA_LATENCY_ADAPTIVE, the number of echo requests per neighbor
+ * follows the link: a neighbor gets at least CONFIG_DCA_LATENCY_PROBES_MIN
+ * and is probed further until the 95 % confidence interval of its mean round
+ * trip time is within +-CONFIG_DCA_LATENCY_CI_PERCENT of the mean, or
+ * CONFIG_DCA_LATENCY_PROBES_MAX requests went out. Stable links finish after
+ * a few probes, noisy or lossy links get more. Without it, every neighbor
+ * gets DEFAULT_COUNT requests.
+ *
+ * A capacity sweep sends echo requests of CAPACITY_SIZES payload sizes
+ * between DEFAULT_DATALEN and CONFIG_DCA_CAPACITY_SIZE_MAX bytes to every
+ * neighbor, each size CONFIG_DCA_CAPACITY_ROUNDS times. The least round trip
+ * time of each size is the one least delayed by queuing; a line fitted
+ * through them separates the time per payload byte, which gives the link
+ * bitrate, from the time of an empty request.
+ *
  */
 #ifndef DORIOT_DCA_LATENCY_H
 #define DORIOT_DCA_LATENCY_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define _SEND_NEXT_PING (0xEF48)
 #define _PING_FINISH (0xEF49)
-#define CKTAB_SIZE (64U * 8) /* 64 byte * 8 bit/byte */
+#define _PING_START (0xEF4A)
 #define DEFAULT_COUNT (3U)
 #define DEFAULT_DATALEN (sizeof(uint32_t))
-#define DEFAULT_ID (0x53)
 #define DEFAULT_INTERVAL_USEC (1U * US_PER_SEC)
 #define DEFAULT_TIMEOUT_USEC (1U * US_PER_SEC)
+/* most echo requests sent to a neighbor per sweep */
+#define LATENCY_PROBES_MAX (32U)
+
+#ifndef CONFIG_DCA_LATENCY_PROBES_MIN
+#define CONFIG_DCA_LATENCY_PROBES_MIN 2
+#endif
+
+#ifndef CONFIG_DCA_LATENCY_PROBES_MAX
+#define CONFIG_DCA_LATENCY_PROBES_MAX 10
+#endif
+
+#ifndef CONFIG_DCA_LATENCY_CI_PERCENT
+#define CONFIG_DCA_LATENCY_CI_PERCENT 10
+#endif
+
+#ifndef CONFIG_DCA_CAPACITY_SIZE_MAX
+#define CONFIG_DCA_CAPACITY_SIZE_MAX 64
+#endif
+
+#ifndef CONFIG_DCA_CAPACITY_ROUNDS
+#define CONFIG_DCA_CAPACITY_ROUNDS 2
+#endif
+
+/* payload sizes of a capacity sweep */
+#define CAPACITY_SIZES (4U)
+/* echo requests per neighbor of a capacity sweep */
+#define CAPACITY_PROBES (CAPACITY_SIZES * CONFIG_DCA_CAPACITY_ROUNDS)
+#define CAPACITY_INTERVAL_USEC (250U * US_PER_MS)
+
+/* echo requests per neighbor and sweep */
+#if CONFIG_DCA_LATENCY_ADAPTIVE
+#define LATENCY_PROBES_LOW (CONFIG_DCA_LATENCY_PROBES_MIN)
+#define LATENCY_PROBES_HIGH (CONFIG_DCA_LATENCY_PROBES_MAX)
+#else
+#define LATENCY_PROBES_LOW DEFAULT_COUNT
+#define LATENCY_PROBES_HIGH DEFAULT_COUNT
+#endif
+
+/**
+ * Called from the pinger thread when a sweep is complete. res is the number
+ * of neighbors that did not answer.
+ */
+typedef void (*latency_done_cb_t)(int res, void *arg);
 
-/** gets network latency and packetloss for each neighbors */
+/**
+ * Start measuring latency and packet loss to all neighbors and return
+ * immediately, cb is called when the sweep is complete. Returns 0, -EBUSY if
+ * a sweep is running, or a negative errno if the pinger thread could not be
+ * started.
+ */
+int db_measure_network_latency_async(latency_done_cb_t cb, void *arg);
+
+/**
+ * gets network latency and packetloss for each neighbors, returns when the
+ * sweep is complete: 0 if all neighbors answered, 1 if not, or a negative
+ * errno
+ */
 int db_measure_network_latency(void);
 
+/** Number of echo requests sent by the last complete sweep */
+uint32_t latency_get_probes(void);
+
+/**
+ * Start estimating the link capacity to all neighbors and return
+ * immediately, cb is called when the sweep is complete with the number of
+ * neighbors without an estimate. Returns 0, -EBUSY if a sweep is running, or
+ * a negative errno if the pinger thread could not be started.
+ */
+int db_measure_network_capacity_async(latency_done_cb_t cb, void *arg);
+
+/**
+ * estimates the link capacity to each neighbor, returns when the sweep is
+ * complete: 0 if there is an estimate for all neighbors, 1 if not, or a
+ * negative errno
+ */
+int db_measure_network_capacity(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    QoS values of the neighbors
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ * @author  Divya Sasidharan <divya.sasidharan@st.ovgu.de>
+ * @author  Adarsh Raghoothaman <adarsh.raghoothaman@st.ovgu.de>
+ *
+ * The table is a static pool of CONFIG_DCA_NEIGHBOR_TABLE_SIZE slots,
+ * indexed by a hash over the IPv6 address. Updates find their entry in
+ * O(1), readers address entries by their slot number, which stays the same
+ * as long as the neighbor is in the table.
+ *
+ * The table follows the gnrc neighbor cache: neighbor_table_sync() passes
+ * every cache entry to neighbor_table_seen(), which gives new neighbors a
+ * slot before they are measured, and then removes the neighbors that were
+ * not in the cache with neighbor_table_expire(). The sampler, the QoS
+ * scheduler and the sweeps over all neighbors sync the table; reading it
+ * never does, so that readers do not lose the slot they are at. A neighbor that was measured within the last
+ * CONFIG_DCA_NEIGHBOR_GRACE_MS stays in the table while it is not in the
+ * cache. If the table is full, the neighbor that has been idle the longest
+ * is evicted.
+ *
+ * Writers are serialized by a seqlock, readers copy entries without
+ * blocking the measurements.
+ */
+#ifndef DORIOT_DCA_NEIGHBOR_TABLE_H
+#define DORIOT_DCA_NEIGHBOR_TABLE_H
+
+#include <stdint.h>
+
+#include "doriot_dca/rtt_hist.h"
+#include "net/ipv6/addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of neighbors the table can hold, at most 254 */
+#ifndef CONFIG_DCA_NEIGHBOR_TABLE_SIZE
+#define CONFIG_DCA_NEIGHBOR_TABLE_SIZE 16
+#endif
+
+/** Time in ms a measured neighbor is kept after it left the neighbor cache */
+#ifndef CONFIG_DCA_NEIGHBOR_GRACE_MS
+#define CONFIG_DCA_NEIGHBOR_GRACE_MS 30000
+#endif
+
+/**
+ * Weight of a new measurement in the moving averages, in 1/256. The
+ * averages follow a change by about 256 / alpha measurements.
+ */
+#ifndef CONFIG_DCA_EWMA_ALPHA
+#define CONFIG_DCA_EWMA_ALPHA 64
+#endif
+
+/** Fractional bits of the moving averages and the jitter */
+#define NEIGHBOR_EWMA_SHIFT (8U)
+#define NEIGHBOR_JITTER_SHIFT (4U)
+
+/** Largest value the moving averages hold, larger values count as this */
+#define NEIGHBOR_EWMA_MAX (UINT32_MAX >> NEIGHBOR_EWMA_SHIFT)
+
+typedef struct {
+    ipv6_addr_t addr;
+    /** Round trip time in us */
+    uint32_t latency;
+    /** Packet loss in percent */
+    uint32_t packet_loss;
+    /** Throughput to the neighbor in bytes/s */
+    uint32_t throughput;
+    /**
+     * Throughput from the neighbor in bytes/s, of the packets its server sent
+     * back in the last throughput test, 0 if none arrived
+     */
+    uint32_t throughput_rx;
+    /**
+     * Link bitrate in bytes/s estimated by a capacity sweep from the round
+     * trip times of echo requests of several sizes, 0 if unknown
+     */
+    uint32_t capacity;
+    /** Round trip time of an empty echo request in us, from the same sweep */
+    uint32_t base_rtt;
+    /** Bottleneck bandwidth in bytes/s from a packet train, 0 if unknown */
+    uint32_t bandwidth;
+    /**
+     * One-way delays to (forward) and from (reverse) the neighbor in us, and
+     * its clock minus the clock of this node in us, from the last delay
+     * measurement with a reply
+     */
+    uint32_t owd_fwd;
+    uint32_t owd_rev;
+    int32_t clock_offset;
+    /**
+     * Data packets of the last bulk test: sent, not arrived, arrived after
+     * a later one and arrived more than once
+     */
+    uint32_t bulk_sent;
+    uint32_t bulk_lost;
+    uint32_t bulk_reordered;
+    uint32_t bulk_duplicates;
+    /**
+     * Exponentially weighted moving averages of latency, packet_loss and
+     * throughput, in fixed point with NEIGHBOR_EWMA_SHIFT fractional bits.
+     * Measurements are clamped to NEIGHBOR_EWMA_MAX, about 16.7 s of
+     * latency or 16.7 MB/s of throughput. Sweeps without replies do not change latency_avg, failed throughput
+     * tests do not change throughput_avg.
+     */
+    uint32_t latency_avg;
+    uint32_t packet_loss_avg;
+    uint32_t throughput_avg;
+    /**
+     * Interarrival jitter of the round trip times in us as in RFC 3550, in
+     * fixed point with NEIGHBOR_JITTER_SHIFT fractional bits
+     */
+    uint32_t jitter;
+    /** Round trip time of the last echo reply in us, 0 if there was none */
+    uint32_t last_rtt;
+    /** Number of latency measurements */
+    uint32_t latency_runs;
+    /** Echo requests sent by the last latency measurement */
+    uint32_t probes;
+    /** Round trip times of all echo replies */
+    rtt_hist_t rtt;
+    /** xtimer_now_usec() when it was last seen in the neighbor cache */
+    uint32_t seen;
+    /** xtimer_now_usec() at the last measurement or when it was added */
+    uint32_t measured;
+} neighbor_entry_t;
+
+/**
+ * Mark a neighbor as seen in the neighbor cache, adds it without
+ * measurement results if it is not in the table yet. Returns its slot, or a
+ * negative errno.
+ */
+int neighbor_table_seen(const ipv6_addr_t *addr);
+
+/**
+ * Remove the neighbors that have not been seen since the xtimer_now_usec()
+ * timestamp since and not measured within the last grace us. Returns the
+ * number of removed neighbors.
+ */
+unsigned neighbor_table_expire(uint32_t since, uint32_t grace);
+
+/**
+ * Add the neighbors of the gnrc neighbor cache of all interfaces and expire
+ * the ones that left it, see neighbor_table_expire() and
+ * CONFIG_DCA_NEIGHBOR_GRACE_MS
+ */
+void neighbor_table_sync(void);
+
+/**
+ * Store the results of a latency measurement of probes echo requests, adds
+ * the neighbor if needed
+ */
+int neighbor_table_update_latency(const ipv6_addr_t *addr, uint32_t latency,
+                                  uint32_t packet_loss, uint32_t probes);
+
+/** Add the round trip time of an echo reply in us, adds the neighbor if
+ * needed */
+int neighbor_table_add_rtt(const ipv6_addr_t *addr, uint32_t rtt);
+
+/**
+ * Store the result of a throughput measurement to (tx) and from (rx) the
+ * neighbor, adds the neighbor if needed
+ */
+int neighbor_table_update_throughput(const ipv6_addr_t *addr,
+                                     uint32_t throughput_tx,
+                                     uint32_t throughput_rx);
+
+/**
+ * Store the result of a capacity estimate, adds the neighbor if needed. A
+ * capacity of 0 keeps the previous estimate.
+ */
+int neighbor_table_update_capacity(const ipv6_addr_t *addr, uint32_t capacity,
+                                   uint32_t base_rtt);
+
+/**
+ * Store the result of a packet train, adds the neighbor if needed. A
+ * bandwidth of 0 keeps the previous estimate.
+ */
+int neighbor_table_update_bandwidth(const ipv6_addr_t *addr,
+                                    uint32_t bandwidth);
+
+/**
+ * Store the result of a one-way delay measurement, adds the neighbor if
+ * needed
+ */
+int neighbor_table_update_delay(const ipv6_addr_t *addr, uint32_t owd_fwd,
+                                uint32_t owd_rev, int32_t clock_offset);
+
+/**
+ * Store the result of a bulk test, the goodput as throughput, adds the
+ * neighbor if needed
+ */
+int neighbor_table_update_bulk(const ipv6_addr_t *addr, uint32_t goodput,
+                               uint32_t sent, uint32_t lost,
+                               uint32_t reordered, uint32_t duplicates);
+
+/** Copy the entry in slot, returns -ENOENT if the slot is empty */
+int neighbor_table_get(unsigned slot, neighbor_entry_t *entry);
+
+/**
+ * Returns the first used slot from slot on, -ENOENT if there is none.
+ * Iterate with neighbor_table_next(0), neighbor_table_next(prev + 1), ...
+ */
+int neighbor_table_next(unsigned slot);
+
+/** Number of neighbors in the table */
+int32_t neighbor_table_get_num(void);
+
+/** Number of neighbors replaced because the table was full */
+int32_t neighbor_table_get_evicted(void);
+
+/** Number of neighbors removed by neighbor_table_expire() */
+int32_t neighbor_table_get_expired(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
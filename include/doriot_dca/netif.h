@@ -19,7 +19,7 @@
 #define DORIOT_DCA_NETIF_H
 
 #include "doriot_dca/db_node.h"
-#include "doriot_dca/linked_list.h"
+#include "doriot_dca/neighbor_table.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +28,9 @@ extern "C" {
 /** Get a ps node instance */
 void db_new_netif_node(db_node_t* node);
 
+/** Sync the neighbor table with the neighbor cache, called by the sampler */
+void db_sample_netif(void);
+
 #ifdef __cplusplus
 }
 #endif
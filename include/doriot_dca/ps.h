@@ -25,6 +25,9 @@ extern "C" {
 /** Get a ps node instance */
 void db_new_ps_node(db_node_t* node);
 
+/** Measure the stack usage of all threads, called by the sampler */
+void db_sample_ps(void);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Periodic QoS measurements within an airtime budget
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * The scheduler thread runs a latency sweep over all neighbors every
+ * latency period and a throughput test to one neighbor after the other
+ * every throughput period. Each period is drawn at random within
+ * +-jitter percent, so that the nodes of a mesh do not measure in sync.
+ *
+ * All measurements draw from one token bucket of bytes, filled at
+ * budget_bps up to burst_bytes. A measurement is deferred until the bucket
+ * holds its estimated traffic, or is full if the measurement needs more than
+ * burst_bytes, so that the measurements never send more than budget_bps on
+ * average. A latency sweep is estimated with the fewest echo requests per
+ * neighbor; the requests sent beyond that are taken from the bucket when the
+ * sweep is complete.
+ */
+#ifndef DORIOT_DCA_QOS_SCHED_H
+#define DORIOT_DCA_QOS_SCHED_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_DCA_QOS_SCHED_LATENCY_PERIOD_S
+#define CONFIG_DCA_QOS_SCHED_LATENCY_PERIOD_S 60
+#endif
+
+#ifndef CONFIG_DCA_QOS_SCHED_THROUGHPUT_PERIOD_S
+#define CONFIG_DCA_QOS_SCHED_THROUGHPUT_PERIOD_S 600
+#endif
+
+#ifndef CONFIG_DCA_QOS_SCHED_JITTER_PERCENT
+#define CONFIG_DCA_QOS_SCHED_JITTER_PERCENT 25
+#endif
+
+#ifndef CONFIG_DCA_QOS_SCHED_BUDGET_BPS
+#define CONFIG_DCA_QOS_SCHED_BUDGET_BPS 32
+#endif
+
+#ifndef CONFIG_DCA_QOS_SCHED_BURST_BYTES
+#define CONFIG_DCA_QOS_SCHED_BURST_BYTES 2048
+#endif
+
+typedef struct {
+    /** Time between latency sweeps in s, 0: no latency sweeps */
+    uint32_t latency_period;
+    /** Time between throughput rounds in s, 0: no throughput tests */
+    uint32_t throughput_period;
+    /** Random variation of the periods in percent, at most 100 */
+    uint32_t jitter_percent;
+    /** Average bytes per second the measurements may send, 0: no limit */
+    uint32_t budget_bps;
+    /** Size of the token bucket in bytes */
+    uint32_t burst_bytes;
+} qos_sched_config_t;
+
+typedef struct {
+    uint32_t latency_runs;
+    uint32_t throughput_runs;
+    /** Number of times a measurement waited for the budget */
+    uint32_t deferred;
+    /** Estimated bytes sent by all measurements */
+    uint32_t bytes;
+    /** Bytes in the token bucket, negative after a measurement of more
+     * than burst_bytes, or a latency sweep that sent more echo requests
+     * than estimated */
+    int32_t tokens;
+} qos_sched_stats_t;
+
+/** starts the scheduler thread */
+int db_start_qos_sched(void);
+
+/** Copy the current configuration */
+void qos_sched_get_config(qos_sched_config_t *config);
+
+/**
+ * Change the configuration, takes effect immediately. Returns 0, or -EINVAL
+ * if jitter_percent is larger than 100.
+ */
+int qos_sched_set_config(const qos_sched_config_t *config);
+
+/** Copy the counters of the scheduler */
+void qos_sched_get_stats(qos_sched_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Log-scale round trip time histogram
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * Bucket 0 holds round trip times below RTT_HIST_UNIT_US, above that each
+ * power of two is split into two buckets, so a percentile is off by at most
+ * a factor of sqrt(2). The last bucket holds everything longer. With the
+ * default of 24 buckets that is about 2 s. When a bucket is full, all
+ * counts are halved, so that older samples fade out.
+ */
+#ifndef DORIOT_DCA_RTT_HIST_H
+#define DORIOT_DCA_RTT_HIST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of buckets, 2 bytes each, at most 44 */
+#ifndef CONFIG_DCA_RTT_HIST_BUCKETS
+#define CONFIG_DCA_RTT_HIST_BUCKETS 24
+#endif
+
+/** Upper bound of bucket 0 in us, a power of two */
+#define RTT_HIST_UNIT_US (1024U)
+
+typedef struct {
+    uint16_t count[CONFIG_DCA_RTT_HIST_BUCKETS];
+    /** Shortest and longest round trip time in us, min is UINT32_MAX if
+     * there are no samples */
+    uint32_t min;
+    uint32_t max;
+    /** Number of samples added */
+    uint32_t samples;
+} rtt_hist_t;
+
+/** Empty the histogram */
+void rtt_hist_init(rtt_hist_t *hist);
+
+/** Add a round trip time in us */
+void rtt_hist_add(rtt_hist_t *hist, uint32_t rtt);
+
+/**
+ * Returns the round trip time in us that percent of the samples do not
+ * exceed, estimated from the buckets and clamped to min and max. Returns 0
+ * if there are no samples.
+ */
+uint32_t rtt_hist_percentile(const rtt_hist_t *hist, unsigned percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
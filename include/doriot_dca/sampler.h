@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Background sampler keeping shadow copies of the db values
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * The sampler thread periodically calls the value functions of all static
+ * int and float entries of a firstlevel branch and stores the results in the
+ * branch's shadow store. Dynamic entries may provide a sample function to
+ * collect their values as well. Readers then only copy the latest sample.
+ * The sampling period is set per branch, see db_index[] and Kconfig.
+ */
+#ifndef DORIOT_DCA_SAMPLER_H
+#define DORIOT_DCA_SAMPLER_H
+
+#include "doriot_dca/db_fl.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_DCA_SAMPLER_RUNTIME_PERIOD_MS
+#define CONFIG_DCA_SAMPLER_RUNTIME_PERIOD_MS 1000
+#endif
+
+#ifndef CONFIG_DCA_SAMPLER_NETWORK_PERIOD_MS
+#define CONFIG_DCA_SAMPLER_NETWORK_PERIOD_MS 5000
+#endif
+
+#ifndef CONFIG_DCA_SAMPLER_SAUL_PERIOD_MS
+#define CONFIG_DCA_SAMPLER_SAUL_PERIOD_MS 10000
+#endif
+
+/** starts sampler thread */
+int db_start_sampler(void);
+
+/**
+ * Copy the latest sample of static entry sub_idx of branch fl_idx. Does not
+ * block the sampler. Returns 0 on success, -ENODATA if the branch has not
+ * been sampled yet.
+ */
+int sampler_read(uint8_t fl_idx, uint8_t sub_idx, db_value_t *value);
+
+/** Return number of sampling rounds */
+int32_t sampler_get_runs(void);
+/** Return duration of the last sampling round in us */
+int32_t sampler_get_last_us(void);
+/** Return CPU time spent sampling in percent */
+float sampler_get_util(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
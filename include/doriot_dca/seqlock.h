@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Sequence lock for the collected metric values
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * Writers serialize on a mutex and make the sequence counter odd while
+ * they modify the data. Readers do not take any lock: they copy the data
+ * and retry if the counter was odd or has changed meanwhile.
+ *
+ *     unsigned seq;
+ *     do {
+ *         seq = seqlock_read_begin(&lock);
+ *         value = data;
+ *     } while (seqlock_read_retry(&lock, seq));
+ *
+ * RIOT does not preempt a thread in favour of one of the same or lower
+ * priority, so a reader must not spin while a write is in progress: it
+ * could starve the preempted writer. Instead it waits on the writer mutex,
+ * which hands the CPU back to the writer.
+ */
+#ifndef DORIOT_DCA_SEQLOCK_H
+#define DORIOT_DCA_SEQLOCK_H
+
+#include "mutex.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    /** Odd while a write is in progress */
+    volatile unsigned seq;
+    /** Serializes the writers */
+    mutex_t lock;
+} seqlock_t;
+
+/** Static initializer for seqlock_t */
+#define SEQLOCK_INIT { .seq = 0, .lock = MUTEX_INIT }
+
+static inline void seqlock_init(seqlock_t *sl)
+{
+    sl->seq = 0;
+    mutex_init(&sl->lock);
+}
+
+static inline void seqlock_write_begin(seqlock_t *sl)
+{
+    mutex_lock(&sl->lock);
+    sl->seq++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(seqlock_t *sl)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sl->seq++;
+    mutex_unlock(&sl->lock);
+}
+
+/** Start reading, returns the sequence number to pass to seqlock_read_retry */
+static inline unsigned seqlock_read_begin(seqlock_t *sl)
+{
+    unsigned seq = sl->seq;
+    while (seq & 1) {
+        /* wait for the writer to finish */
+        mutex_lock(&sl->lock);
+        mutex_unlock(&sl->lock);
+        seq = sl->seq;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return seq;
+}
+
+/** Returns nonzero if the data read since seqlock_read_begin may be torn */
+static inline int seqlock_read_retry(seqlock_t *sl, unsigned seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return sl->seq != seq;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+ * @defgroup doriot_dca DoRIoT Data Collection Agent
+ * @ingroup  doriot
+ * @brief
+ * @{
+ *
+ * @file
+ * @brief    Binary snapshot of the database
+ *
+ * @author  Frank Engelhardt <fengelha@ovgu.de>
+ *
+ * A snapshot serializes a subtree in one pass. All numbers are big endian.
+ *
+ *     header:  u8 format (DB_SNAPSHOT_FORMAT), u8 flags (0),
+ *              u16 size of the name table, u32 sequence number
+ *     node:    u8 tag, name, value
+ *     tag:     the db_node_type_t, | DB_SNAPSHOT_NAME_REF if the name is
+ *              interned
+ *     name:    u16 offset into the name table if DB_SNAPSHOT_NAME_REF,
+ *              u8 length and the characters otherwise
+ *     value:   int: s32, float: IEEE 754 single, str: u8 length and the
+ *              characters, inner: the child nodes and a 0 tag
+ *
+ * The name table is db_fl_strtab, the names of the static part of the
+ * database. Its size in the header tells whether a collector's copy matches
+ * the firmware. The sequence number counts the snapshots taken since boot.
+ *
+ * CoAP and VFS serve snapshots from one shared buffer, so that a snapshot
+ * read in several blocks or read() calls stays consistent. Taking a new
+ * snapshot replaces the buffer; readers of the old one get -ESTALE.
+ */
+#ifndef DORIOT_DCA_SNAPSHOT_H
+#define DORIOT_DCA_SNAPSHOT_H
+
+#include "doriot_dca/db_node.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the shared snapshot buffer */
+#ifndef CONFIG_DCA_SNAPSHOT_BUF_SIZE
+#define CONFIG_DCA_SNAPSHOT_BUF_SIZE 1024
+#endif
+
+/** Format version in the snapshot header */
+#define DB_SNAPSHOT_FORMAT (1U)
+/** Size of the snapshot header */
+#define DB_SNAPSHOT_HEADER_SIZE (8U)
+/** Tag flag: the name is an offset into the name table */
+#define DB_SNAPSHOT_NAME_REF (0x80U)
+/** Name of the snapshot file below a node in the CoAP and VFS path space */
+#define DB_SNAPSHOT_NAME ".snapshot"
+/** Name of the name table file in the CoAP and VFS path space */
+#define DB_SNAPSHOT_STRTAB_NAME ".strtab"
+
+/**
+ * Serialize the subtree below base (the root if NULL) into buf. Returns the
+ * size of the snapshot, which is truncated if that is more than bufsize.
+ */
+size_t db_snapshot(const db_node_t *base, void *buf, size_t bufsize);
+
+/**
+ * Take a snapshot of base into the shared buffer. Returns its size and
+ * stores its sequence number in seq, -EFBIG if it does not fit.
+ */
+int db_snapshot_take(const db_node_t *base, uint32_t *seq);
+
+/**
+ * Copy up to bufsize bytes from offset of snapshot *seq in the shared buffer
+ * into buf. If *seq is 0, use the snapshot the buffer holds and store its
+ * number in *seq. Returns the size of the whole snapshot, so the number of
+ * bytes copied is the part of it beyond offset, at most bufsize. Returns
+ * -ESTALE if the buffer holds another snapshot, -ENODATA if it holds none.
+ */
+ssize_t db_snapshot_read(uint32_t *seq, size_t offset, void *buf,
+                         size_t bufsize);
+
+/**
+ * If the last component of path is DB_SNAPSHOT_NAME, find the node whose
+ * snapshot it names, e.g. "runtime" for "runtime/.snapshot". Returns 0 on
+ * success, -ENOENT if path does not name a snapshot or the node is missing.
+ */
+int db_snapshot_find(const char *path, db_node_t *base);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
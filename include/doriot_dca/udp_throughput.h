@@ -11,17 +11,201 @@
  * @author  Frank Engelhardt <fengelha@ovgu.de>
  * @author  Divya Sasidharan <divya.sasidharan@st.ovgu.de>
  * @author  Adarsh Raghoothaman <adarsh.raghoothaman@st.ovgu.de>
+ *
+ * After the data packets of a throughput test, the server sends as many
+ * back as the client asked for, at most as many as arrived, so that the
+ * throughput is measured in both directions of asymmetric links.
+ *
+ * Besides the throughput test, the server answers packet trains: the client
+ * sends CONFIG_DCA_UDP_TRAIN_LENGTH packets back to back, the bottleneck
+ * link on the way spaces them out by the time it takes to send one. The
+ * server timestamps their arrival and reports the bandwidth from the median
+ * gap between two consecutive packets.
+ *
+ * The server runs up to CONFIG_DCA_UDP_SESSIONS tests at a time, one per
+ * client endpoint, on a single socket. Each session ends when its test is
+ * complete or when its client has not sent anything for a second; the server
+ * then replies with what has arrived so far. A client that starts a test
+ * while all sessions are in use is told so right away.
+ *
+ * Neither side copies the payload of the data packets: the sender builds
+ * them in the packet buffer from a header and a zeroed pad that all packets
+ * share, the receiver reads the header in the packet buffer.
+ *
+ * A delay probe carries the time it was sent, the server answers it right
+ * away with the times the probe arrived and the reply left, on its own
+ * clock. As in NTP, the four timestamps give the round trip time without the
+ * time the server held the probe, and the offset of the server clock if
+ * both directions take the same time. The client takes the offset from the
+ * probe with the least round trip time and reports the least delay of each
+ * direction against it; without synchronized clocks the split of that round
+ * trip time cannot be measured, the per-direction delays differ by the
+ * queueing that only one direction sees.
+ *
+ * A bulk test sends numbered data packets for a time or up to a number of
+ * bytes, as fast as possible or paced to a rate. The server counts the
+ * packets that arrive, those that arrive after a later one (reordered) and
+ * those that arrive twice, and reports them with the goodput when the client
+ * ends the test.
  */
+#ifndef DORIOT_DCA_UDP_THROUGHPUT_H
+#define DORIOT_DCA_UDP_THROUGHPUT_H
+
+#include <stdint.h>
+
+#include "net/ipv6/addr.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Number of data packets of a throughput test */
+#define UDP_PACKET_COUNT 3
+/** Payload size of the data packets of a throughput test */
+#define UDP_PACKET_SIZE 128
+
+/** Number of tests the server runs at a time, 1 to 255 */
+#ifndef CONFIG_DCA_UDP_SESSIONS
+#define CONFIG_DCA_UDP_SESSIONS 4
+#endif
+
+/**
+ * Time in ms between two tests of a sweep over the neighbors, so that the
+ * packets of one test have left the queues before the next test starts
+ */
+#ifndef CONFIG_DCA_UDP_GUARD_MS
+#define CONFIG_DCA_UDP_GUARD_MS 100
+#endif
+
+/** Number of packets of a packet train, 2 to 32 */
+#ifndef CONFIG_DCA_UDP_TRAIN_LENGTH
+#define CONFIG_DCA_UDP_TRAIN_LENGTH 5
+#endif
+
+/** Payload size of the packets of a packet train, at least 12 */
+#ifndef CONFIG_DCA_UDP_TRAIN_SIZE
+#define CONFIG_DCA_UDP_TRAIN_SIZE 64
+#endif
+
+/**
+ * Largest payload of the data packets the server accepts and a bulk test
+ * sends, at most 1232 (IPv6 minimum MTU without headers)
+ */
+#ifndef CONFIG_DCA_UDP_SIZE_MAX
+#define CONFIG_DCA_UDP_SIZE_MAX 256
+#endif
+
+/** Default duration of a bulk test in ms */
+#ifndef CONFIG_DCA_UDP_BULK_DURATION_MS
+#define CONFIG_DCA_UDP_BULK_DURATION_MS 2000
+#endif
+
+/** Default payload size of the data packets of a bulk test */
+#ifndef CONFIG_DCA_UDP_BULK_SIZE
+#define CONFIG_DCA_UDP_BULK_SIZE 128
+#endif
+
+/** Number of timestamp probes of a one-way delay measurement, 1 to 32 */
+#ifndef CONFIG_DCA_UDP_DELAY_PROBES
+#define CONFIG_DCA_UDP_DELAY_PROBES 8
+#endif
+
+/** Longest bulk test in ms */
+#define UDP_BULK_DURATION_MAX_MS (600000UL)
+
+typedef struct {
+    /** Time to send in ms, 0: until bytes are sent */
+    uint32_t duration_ms;
+    /** Payload bytes to send, 0: for duration_ms */
+    uint32_t bytes;
+    /** Payload size of the data packets */
+    uint32_t size;
+    /** Sending rate in bytes/s, 0: as fast as possible */
+    uint32_t rate;
+} udp_bulk_params_t;
+
+typedef struct {
+    /** Payload bytes/s that arrived, without duplicates */
+    uint32_t goodput;
+    /** Data packets sent */
+    uint32_t sent;
+    /** Data packets that did not arrive */
+    uint32_t lost;
+    /** Data packets that arrived after a later one */
+    uint32_t reordered;
+    /** Data packets that arrived more than once, counted per copy */
+    uint32_t duplicates;
+} udp_bulk_result_t;
+
 /** gets network throughput for each neighbors */
 int db_measure_network_throughput(void);
 
+/** gets network throughput to the neighbor addr */
+int db_measure_neighbor_throughput(const ipv6_addr_t *addr);
+
+/** estimates the bottleneck bandwidth to each neighbor with packet trains */
+int db_measure_network_bandwidth(void);
+
+/** estimates the bottleneck bandwidth to the neighbor addr */
+int db_measure_neighbor_bandwidth(const ipv6_addr_t *addr);
+
+/**
+ * estimates the one-way delays to and from each neighbor and the offset of
+ * its clock with timestamp probes
+ */
+int db_measure_network_delay(void);
+
+/** estimates the one-way delays to and from the neighbor addr */
+int db_measure_neighbor_delay(const ipv6_addr_t *addr);
+
+/** Set params to the default bulk test */
+void udp_bulk_params_init(udp_bulk_params_t *params);
+
+/**
+ * Set one parameter of a bulk test by name, as given to "dcatp bulk": time
+ * (ms), bytes, size or rate (bytes/s). Returns 0, or -EINVAL if the name is
+ * unknown or the value out of range.
+ */
+int udp_bulk_params_set(udp_bulk_params_t *params, const char *name,
+                        const char *value);
+
+/**
+ * Run a bulk test to the neighbor addr and store the goodput as its
+ * throughput. Returns 0 if the server reported a result, otherwise a
+ * negative errno; result is filled in either way.
+ */
+int db_measure_neighbor_bulk(const ipv6_addr_t *addr,
+                             const udp_bulk_params_t *params,
+                             udp_bulk_result_t *result);
+
+/** Run a bulk test to each neighbor one after the other */
+int db_measure_network_bulk(const udp_bulk_params_t *params);
+
+/**
+ * Start db_measure_network_bulk() in a separate thread and return
+ * immediately. Returns 0, -EBUSY if a bulk test is running, or a negative
+ * errno if the thread could not be started.
+ */
+int db_measure_network_bulk_async(const udp_bulk_params_t *params);
+
 /** starts server thread */
 int db_start_udp_server(void);
 
+/** Number of tests the server is running */
+int32_t udp_server_get_sessions(void);
+
+/** Number of tests the server turned away because all sessions were in use */
+int32_t udp_server_get_rejected(void);
+
+/** Number of tests that ended because the client stopped sending */
+int32_t udp_server_get_expired(void);
+
+/** Number of packets the server dropped as malformed or out of session */
+int32_t udp_server_get_dropped(void);
+
 #ifdef __cplusplus
 }
 #endif
+
+/** @} */
+#endif
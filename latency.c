@@ -13,29 +13,29 @@
  * published under GPLv3
  *
  */
-#ifdef __STDC_ALLOC_LIB__
-#define __STDC_WANT_LIB_EXT2__ 1
-#else
-#define _POSIX_C_SOURCE 200809L
-#endif
-
 #include "doriot_dca/latency.h"
-#include "doriot_dca/linked_list.h"
+#include "doriot_dca/neighbor_table.h"
 
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
-#include <limits.h>
 
-#include "bitfield.h"
+#include "atomic_utils.h"
 #include "byteorder.h"
+#include "kernel_defines.h"
 #include "msg.h"
+#include "mutex.h"
 #include "net/gnrc.h"
+#include "net/gnrc/ipv6.h"
 #include "net/gnrc/icmpv6.h"
+#include "net/gnrc/ipv6/nib/nc.h"
 #include "net/icmpv6.h"
 #include "net/ipv6.h"
+#include "thread.h"
 #include "timex.h"
 #include "utlist.h"
 #include "xtimer.h"
@@ -46,269 +46,529 @@
 #define ENABLE_DEBUG (0)
 #include "debug.h"
 
-#if(POSIX_C_SOURCE < 200809L && _XOPEN_SOURCE < 700)
-char *strndup(const char *s, size_t n)
-{
-    char *ret = malloc(n);
-    strcpy(ret, s);
-    return ret;
-}
+#define LATENCY_MSG_QUEUE_SIZE (16U)
+
+#if (LATENCY_PROBES_LOW < 1) || (LATENCY_PROBES_LOW > LATENCY_PROBES_HIGH) || \
+    (LATENCY_PROBES_HIGH > LATENCY_PROBES_MAX)
+#error "latency: need 1 <= probes min <= probes max <= LATENCY_PROBES_MAX"
+#endif
+
+#if CAPACITY_PROBES > LATENCY_PROBES_MAX
+#error "latency: a capacity sweep needs more than LATENCY_PROBES_MAX probes"
 #endif
 
+static_assert(CONFIG_DCA_CAPACITY_SIZE_MAX >= DEFAULT_DATALEN + CAPACITY_SIZES - 1,
+              "capacity sweep payload sizes must differ");
+
+/* echo requests and replies to one neighbor during a sweep */
+typedef struct {
+    ipv6_addr_t host;
+    uint32_t tsum;
+    uint32_t tmin, tmax;
+    /* one bit per sequence number answered */
+    uint32_t cktab;
+    uint8_t num_sent, num_recv, num_rept;
+    /* no more echo requests for this neighbor */
+    bool done;
+    /* running mean and sum of squared deviations of the round trip times
+     * without duplicates (Welford), in us and us^2 */
+    uint32_t mean;
+    uint64_t m2;
+    /* capacity sweep: least round trip time of each payload size */
+    uint32_t size_min[CAPACITY_SIZES];
+    /* interface of the neighbor cache entry, 0 if unknown */
+    kernel_pid_t iface;
+    bool active;
+} _ping_data_t;
+
 typedef struct {
     gnrc_netreg_entry_t netreg;
     xtimer_t sched_timer;
     msg_t sched_msg;
-    ipv6_addr_t host;
-    char *hostname;
-    unsigned long num_sent, num_recv, num_rept;
-    unsigned long long tsum;
-    unsigned tmin, tmax;
-    unsigned count;
-    size_t datalen;
-    BITFIELD(cktab, CKTAB_SIZE);
-    uint32_t timeout;
+    latency_done_cb_t cb;
+    void *arg;
+    /* number of active neighbors */
+    uint8_t num;
+    /* upper byte of the ICMPv6 id, and the content of the timer messages of
+     * the sweep; changed under _start_lock */
+    uint8_t gen;
+    /* replies (without duplicates) to the requests sent so far still
+     * expected */
+    uint16_t pending;
+    /* echo requests sent by this sweep */
+    uint32_t probes;
     uint32_t interval;
-    gnrc_netif_t *netif;
-    uint16_t id;
-    uint8_t hoplimit;
-    uint8_t pattern;
-} _ping_data_t;
+    /* capacity sweep instead of latency sweep */
+    bool capacity;
+    bool running;
+    /* capacity sweep: zeroed payload after the timestamp of each size,
+     * shared by all echo requests of that size, NULL for the smallest */
+    gnrc_pktsnip_t *pad[CAPACITY_SIZES];
+} _sweep_t;
 
-static int _configure(ipv6_addr_t *neigh, _ping_data_t *data);
-static void _pinger(_ping_data_t *data);
-static void _print_reply(_ping_data_t *data, gnrc_pktsnip_t *icmpv6,
-                         ipv6_addr_t *from, unsigned hoplimit, gnrc_netif_hdr_t *netif_hdr);
-static void _handle_reply(_ping_data_t *data, gnrc_pktsnip_t *pkt);
-static int _finish(_ping_data_t *data);
+typedef struct {
+    mutex_t done;
+    int res;
+} _blocking_t;
+
+static char _pinger_stack[THREAD_STACKSIZE_DEFAULT];
+static kernel_pid_t _pinger_pid = KERNEL_PID_UNDEF;
+/* serializes starting sweeps */
+static mutex_t _start_lock = MUTEX_INIT;
+
+/* only touched by the pinger thread, except cb, arg, gen and running */
+static _sweep_t _sweep;
+/* indexed by the neighbor table slot */
+static _ping_data_t _neighbors[CONFIG_DCA_NEIGHBOR_TABLE_SIZE];
+/* echo requests of the last complete sweep */
+static uint32_t _last_probes = 0;
+
+#if CONFIG_DCA_LATENCY_ADAPTIVE
+/* squared two-sided 95 % quantiles of Student's t distribution times 16, by
+ * degrees of freedom, the last one is used for all above */
+static const uint16_t _t2_x16[] = { 2583, 296, 162, 123, 106, 96, 90, 85, 82, 79 };
+#endif
 
-int db_measure_network_latency(void)
+static void _start(bool capacity);
+static void _pinger(void);
+static size_t _capacity_size(unsigned seq);
+static void _send(unsigned slot);
+static void _print_reply(gnrc_pktsnip_t *icmpv6, ipv6_addr_t *from,
+                         unsigned hoplimit, gnrc_netif_hdr_t *netif_hdr);
+static void _handle_reply(gnrc_pktsnip_t *pkt);
+static void _finish(void);
+
+/* Whether msg of the interval timer belongs to the sweep in progress. The
+ * timer may have queued it before the sweep ended, xtimer_remove() does not
+ * take it back. */
+static bool _current(const msg_t *msg)
 {
-    int res = 0;
-    unsigned iface = 0;
-    void *state = NULL;
-    gnrc_ipv6_nib_nc_t nce;
+    mutex_lock(&_start_lock);
+    bool current = _sweep.running && (msg->content.value == _sweep.gen);
+    mutex_unlock(&_start_lock);
+    return current;
+}
 
-    while (gnrc_ipv6_nib_nc_iter(iface, &state, &nce)) {
-        _ping_data_t data = {
-            .netreg = GNRC_NETREG_ENTRY_INIT_PID(ICMPV6_ECHO_REP,
-                                                 thread_getpid()),
-            .count = DEFAULT_COUNT,
-            .tmin = UINT_MAX,
-            .datalen = DEFAULT_DATALEN,
-            .timeout = DEFAULT_TIMEOUT_USEC,
-            .interval = DEFAULT_INTERVAL_USEC,
-            .id = DEFAULT_ID,
-            .pattern = DEFAULT_ID,
-        };
-
-        if ((res = _configure(&nce.ipv6, &data)) != 0) {
-            return res;
-        }
-        gnrc_netreg_register(GNRC_NETTYPE_ICMPV6, &data.netreg);
-        _pinger(&data);
-        do{
-            msg_t msg;
-            msg_receive(&msg);
-            switch (msg.type) {
-            case GNRC_NETAPI_MSG_TYPE_RCV:
-            {
-                _handle_reply(&data, msg.content.ptr);
-                gnrc_pktbuf_release(msg.content.ptr);
-                break;
-            }
-            case _SEND_NEXT_PING:
-                _pinger(&data);
-                break;
-            case _PING_FINISH:
-                goto finish;
-            default:
-                /* requeue wrong packets */
-                msg_send(&msg, thread_getpid());
-                break;
+static void *_pinger_thread(void *arg)
+{
+    (void)arg;
+    msg_t queue[LATENCY_MSG_QUEUE_SIZE];
+
+    msg_init_queue(queue, LATENCY_MSG_QUEUE_SIZE);
+    gnrc_netreg_entry_init_pid(&_sweep.netreg, ICMPV6_ECHO_REP,
+                               thread_getpid());
+    while (1) {
+        msg_t msg;
+        msg_receive(&msg);
+        switch (msg.type) {
+        case GNRC_NETAPI_MSG_TYPE_RCV:
+            if (_sweep.running) {
+                _handle_reply(msg.content.ptr);
             }
-        } while (data.num_recv < data.count);
-finish:
-        xtimer_remove(&data.sched_timer);
-        res = _finish(&data);
-        gnrc_netreg_unregister(GNRC_NETTYPE_ICMPV6, &data.netreg);
-        for (unsigned i = 0;
-             i < cib_avail((cib_t *)&thread_get_active()->msg_queue);
-             i++) {
-            msg_t msg;
-
-            /* remove all remaining messages (likely caused by duplicates) */
-            if ((msg_try_receive(&msg) > 0) &&
-                (msg.type == GNRC_NETAPI_MSG_TYPE_RCV) &&
-                (((gnrc_pktsnip_t *)msg.content.ptr)->type == GNRC_NETTYPE_ICMPV6)) {
-                gnrc_pktbuf_release(msg.content.ptr);
+            gnrc_pktbuf_release(msg.content.ptr);
+            break;
+        case _PING_START:
+            _start(msg.content.value);
+            break;
+        case _SEND_NEXT_PING:
+            if (_current(&msg)) {
+                _pinger();
             }
-            else {
-                /* requeue other packets */
-                msg_send(&msg, thread_getpid());
+            break;
+        case _PING_FINISH:
+            if (_current(&msg)) {
+                _finish();
             }
+            break;
+        default:
+            DEBUG("latency: unexpected message type %04x\n", msg.type);
+            break;
         }
     }
-    return res;
+    return NULL;
+}
+
+static int _start_sweep(bool capacity, latency_done_cb_t cb, void *arg)
+{
+    msg_t msg = { .type = _PING_START, .content.value = capacity };
+    int res = 0;
+
+    mutex_lock(&_start_lock);
+    if (_pinger_pid == KERNEL_PID_UNDEF) {
+        res = thread_create(_pinger_stack, sizeof(_pinger_stack),
+                            THREAD_PRIORITY_MAIN - 1, THREAD_CREATE_STACKTEST,
+                            _pinger_thread, NULL, "dca_pinger");
+        if (res > KERNEL_PID_UNDEF) {
+            _pinger_pid = res;
+            res = 0;
+        }
+    }
+    if ((res == 0) && _sweep.running) {
+        res = -EBUSY;
+    }
+    if (res == 0) {
+        _sweep.cb = cb;
+        _sweep.arg = arg;
+        /* timer messages of the last sweep no longer match */
+        _sweep.gen++;
+        _sweep.running = true;
+    }
+    mutex_unlock(&_start_lock);
+    if (res < 0) {
+        return res;
+    }
+    /* not under _start_lock, which _done() takes in the pinger thread */
+    if (thread_getpid() == _pinger_pid) {
+        /* started from a completion callback */
+        msg_send_to_self(&msg);
+    }
+    else {
+        msg_send(&msg, _pinger_pid);
+    }
+    return 0;
 }
 
-/* get the next netif, returns true if there are more */
-static bool _netif_get(gnrc_netif_t **current_netif)
+static void _wake(int res, void *arg)
 {
-    gnrc_netif_t *netif = *current_netif;
+    _blocking_t *blocking = arg;
+    blocking->res = (res > 0);
+    mutex_unlock(&blocking->done);
+}
+
+static int _run_blocking(bool capacity)
+{
+    _blocking_t blocking = { .done = MUTEX_INIT_LOCKED, .res = 0 };
+    int res = _start_sweep(capacity, _wake, &blocking);
+
+    if (res < 0) {
+        return res;
+    }
+    mutex_lock(&blocking.done);
+    return blocking.res;
+}
 
-    netif = gnrc_netif_iter(netif);
+int db_measure_network_latency_async(latency_done_cb_t cb, void *arg)
+{
+    return _start_sweep(false, cb, arg);
+}
 
-    *current_netif = netif;
-    return !gnrc_netif_highlander() && gnrc_netif_iter(netif);
+int db_measure_network_latency(void)
+{
+    return _run_blocking(false);
 }
 
-static int _configure(ipv6_addr_t *neigh, _ping_data_t *data)
+int db_measure_network_capacity_async(latency_done_cb_t cb, void *arg)
 {
-    int res = 1;
-    char addr_str[IPV6_ADDR_MAX_STR_LEN];
+    return _start_sweep(true, cb, arg);
+}
 
-    ipv6_addr_to_str(addr_str, neigh, sizeof(addr_str));
-    data->hostname = strndup(addr_str, IPV6_ADDR_MAX_STR_LEN);
-    char *iface = ipv6_addr_split_iface(data->hostname);
+int db_measure_network_capacity(void)
+{
+    return _run_blocking(true);
+}
 
-    if (iface) {
-        data->netif = gnrc_netif_get_by_pid(atoi(iface));
-        res = 0;
+uint32_t latency_get_probes(void)
+{
+    return atomic_load_u32(&_last_probes);
+}
+
+/* end of the sweep, hand the result to the callback */
+static void _done(int res)
+{
+    gnrc_netreg_unregister(GNRC_NETTYPE_ICMPV6, &_sweep.netreg);
+    for (unsigned i = 0; i < CAPACITY_SIZES; i++) {
+        if (_sweep.pad[i] != NULL) {
+            /* requests still queued keep their own reference */
+            gnrc_pktbuf_release(_sweep.pad[i]);
+            _sweep.pad[i] = NULL;
+        }
     }
-    /* preliminary select the first interface */
-    else if (_netif_get(&data->netif)) {
-        /* don't take it if there is more than one interface */
-        data->netif = NULL;
-        res = 1;
+    atomic_store_u32(&_last_probes, _sweep.probes);
+    mutex_lock(&_start_lock);
+    latency_done_cb_t cb = _sweep.cb;
+    void *arg = _sweep.arg;
+    _sweep.cb = NULL;
+    _sweep.running = false;
+    mutex_unlock(&_start_lock);
+    if (cb) {
+        cb(res, arg);
     }
-    if (ipv6_addr_from_str(&data->host, data->hostname) == NULL) {
-        res = 1;
+}
+
+static void _start(bool capacity)
+{
+    void *state = NULL;
+    gnrc_ipv6_nib_nc_t nce;
+    uint32_t start = xtimer_now_usec();
+
+    memset(_neighbors, 0, sizeof(_neighbors));
+    _sweep.num = 0;
+    _sweep.pending = 0;
+    _sweep.probes = 0;
+    _sweep.capacity = capacity;
+    _sweep.interval = capacity ? CAPACITY_INTERVAL_USEC : DEFAULT_INTERVAL_USEC;
+    while (gnrc_ipv6_nib_nc_iter(0, &state, &nce)) {
+        int slot = neighbor_table_seen(&nce.ipv6);
+        if ((slot < 0) || _neighbors[slot].active) {
+            /* more neighbors in the cache than slots in the table */
+            continue;
+        }
+        _ping_data_t *data = &_neighbors[slot];
+        data->host = nce.ipv6;
+        data->iface = gnrc_ipv6_nib_nc_get_iface(&nce);
+        data->tmin = UINT32_MAX;
+        memset(data->size_min, 0xff, sizeof(data->size_min));
+        data->active = true;
+        _sweep.num++;
     }
-    else {
-        res = 0;
+    /* the whole cache has been seen, see neighbor_table_sync() */
+    neighbor_table_expire(start, CONFIG_DCA_NEIGHBOR_GRACE_MS * US_PER_MS);
+    DEBUG("latency: %s sweep %u over %u neighbors\n",
+          capacity ? "capacity" : "latency", _sweep.gen, _sweep.num);
+    if (_sweep.num == 0) {
+        _done(0);
+        return;
+    }
+    for (unsigned i = 1; capacity && (i < CAPACITY_SIZES); i++) {
+        size_t len = _capacity_size(i) - DEFAULT_DATALEN;
+        /* without it, _send() builds the whole request */
+        _sweep.pad[i] = gnrc_pktbuf_add(NULL, NULL, len, GNRC_NETTYPE_UNDEF);
+        if (_sweep.pad[i] != NULL) {
+            memset(_sweep.pad[i]->data, 0, len);
+        }
     }
-    data->id ^= (xtimer_now_usec() & UINT16_MAX);
-    return res;
+    gnrc_netreg_register(GNRC_NETTYPE_ICMPV6, &_sweep.netreg);
+    _pinger();
 }
 
-static void _pinger(_ping_data_t *data)
+#if CONFIG_DCA_LATENCY_ADAPTIVE
+/* whether the 95 % confidence interval of the mean round trip time is within
+ * +-CONFIG_DCA_LATENCY_CI_PERCENT of the mean */
+static bool _converged(const _ping_data_t *data)
 {
-    gnrc_pktsnip_t *pkt, *tmp;
-    ipv6_hdr_t *ipv6;
-    uint32_t timer;
-    uint8_t *databuf;
+    unsigned n = data->num_recv;
 
-    /* schedule next event (next ping or finish) ASAP */
-    if ((data->num_sent + 1) < data->count) {
-        /* didn't send all pings yet - schedule next in data->interval */
-        data->sched_msg.type = _SEND_NEXT_PING;
-        timer = data->interval;
+    if (n < 2) {
+        return false;
     }
-    else {
-        /* Wait for the last ping to come back.
-         * data->timeout: wait for a response in milliseconds.
-         * Affects only timeout in absence of any responses,
-         * otherwise ping waits for two max RTTs. */
-        data->sched_msg.type = _PING_FINISH;
-        timer = data->timeout;
-        if (data->num_recv) {
-            /* approx. 2*tmax, in seconds (2 RTT) */
-            timer = (data->tmax / (512UL * 1024UL)) * US_PER_SEC;
-            if (timer == 0) {
-                timer = 1U * US_PER_SEC;
-            }
+    unsigned dof = n - 1;
+    uint64_t t2 = _t2_x16[((dof < ARRAY_SIZE(_t2_x16)) ? dof
+                                                       : ARRAY_SIZE(_t2_x16)) - 1];
+    /* squared standard error of the mean in us^2 */
+    uint64_t var = data->m2 / ((uint64_t)n * dof);
+    uint64_t bound = ((uint64_t)data->mean * CONFIG_DCA_LATENCY_CI_PERCENT);
+
+    if (bound > UINT32_MAX) {
+        bound = UINT32_MAX;
+    }
+    /* t * sqrt(var) <= mean * percent / 100, squared on both sides; t2 is
+     * scaled by 16, so 100^2 / 16 = 625 */
+    if (var > UINT64_MAX / (t2 * 625)) {
+        return false;
+    }
+    return var * t2 * 625 <= bound * bound;
+}
+#endif
+
+/* whether the neighbor needs no more echo requests, marks it done */
+static bool _enough(_ping_data_t *data)
+{
+    if (_sweep.capacity) {
+        data->done = (data->num_sent >= CAPACITY_PROBES);
+    }
+    else if (data->num_sent >= LATENCY_PROBES_HIGH) {
+        data->done = true;
+    }
+    else if (data->num_sent >= LATENCY_PROBES_LOW) {
+#if CONFIG_DCA_LATENCY_ADAPTIVE
+        /* more requests will not help a neighbor that never answered */
+        data->done = data->done || (data->num_recv == 0) || _converged(data);
+#else
+        data->done = true;
+#endif
+    }
+    return data->done;
+}
+
+/* returns the number of neighbors that need more echo requests */
+static unsigned _probing(void)
+{
+    unsigned num = 0;
+
+    for (unsigned slot = 0; slot < CONFIG_DCA_NEIGHBOR_TABLE_SIZE; slot++) {
+        if (_neighbors[slot].active && !_enough(&_neighbors[slot])) {
+            num++;
         }
     }
-    xtimer_set_msg(&data->sched_timer, timer, &data->sched_msg,
-                   thread_getpid());
-    bf_unset(data->cktab, (size_t)data->num_sent % CKTAB_SIZE);
-    pkt = gnrc_icmpv6_echo_build(ICMPV6_ECHO_REQ, data->id,
-                                 (uint16_t)data->num_sent++,
-                                 NULL, data->datalen);
+    return num;
+}
+
+/* send the next echo request to every neighbor that needs one */
+static void _pinger(void)
+{
+    if (_probing() == 0) {
+        /* The last requests went out one interval ago. Wait for their
+         * replies up to the timeout, the sweep finishes earlier when all
+         * replies are in. */
+        if ((_sweep.pending == 0) || (DEFAULT_TIMEOUT_USEC <= _sweep.interval)) {
+            _finish();
+            return;
+        }
+        _sweep.sched_msg.type = _PING_FINISH;
+        _sweep.sched_msg.content.value = _sweep.gen;
+        xtimer_set_msg(&_sweep.sched_timer,
+                       DEFAULT_TIMEOUT_USEC - _sweep.interval,
+                       &_sweep.sched_msg, thread_getpid());
+        return;
+    }
+    /* schedule the next round ASAP, it stops when no neighbor needs more */
+    _sweep.sched_msg.type = _SEND_NEXT_PING;
+    _sweep.sched_msg.content.value = _sweep.gen;
+    xtimer_set_msg(&_sweep.sched_timer, _sweep.interval,
+                   &_sweep.sched_msg, thread_getpid());
+    for (unsigned slot = 0; slot < CONFIG_DCA_NEIGHBOR_TABLE_SIZE; slot++) {
+        if (_neighbors[slot].active && !_neighbors[slot].done) {
+            _send(slot);
+        }
+    }
+}
+
+/* payload size of the echo requests of a capacity sweep with sequence
+ * number seq; the sizes take turns, so that changes of the link during the
+ * sweep hit all of them alike */
+static size_t _capacity_size(unsigned seq)
+{
+    return DEFAULT_DATALEN + ((seq % CAPACITY_SIZES) *
+                              (CONFIG_DCA_CAPACITY_SIZE_MAX - DEFAULT_DATALEN)) /
+                             (CAPACITY_SIZES - 1);
+}
+
+static void _send(unsigned slot)
+{
+    _ping_data_t *data = &_neighbors[slot];
+    gnrc_pktsnip_t *pkt, *tmp;
+    uint8_t *databuf;
+    uint32_t now;
+    size_t len = _sweep.capacity ? _capacity_size(data->num_sent)
+                                 : DEFAULT_DATALEN;
+    gnrc_pktsnip_t *pad = _sweep.capacity
+                          ? _sweep.pad[data->num_sent % CAPACITY_SIZES] : NULL;
+
+    /* only the timestamp is written per request, the rest of the payload is
+     * the pad snip of its size */
+    pkt = gnrc_icmpv6_echo_build(ICMPV6_ECHO_REQ, (_sweep.gen << 8) | slot,
+                                 data->num_sent++, NULL,
+                                 pad ? DEFAULT_DATALEN : len);
+    /* a request that could not be sent counts as lost */
+    _sweep.probes++;
     if (pkt == NULL) {
         DEBUG("error: packet buffer full\n");
         return;
     }
     databuf = (uint8_t *)(pkt->data) + sizeof(icmpv6_echo_t);
-    memset(databuf, data->pattern, data->datalen);
+    if (pad != NULL) {
+        gnrc_pktbuf_hold(pad, 1);
+        pkt->next = pad;
+    }
+    else if (len > sizeof(now)) {
+        memset(databuf + sizeof(now), 0, len - sizeof(now));
+    }
     tmp = gnrc_ipv6_hdr_build(pkt, NULL, &data->host);
     if (tmp == NULL) {
         DEBUG("error: packet buffer full\n");
         goto error_exit;
     }
     pkt = tmp;
-    ipv6 = pkt->data;
-    /* if data->hoplimit is unset (i.e. 0) gnrc_ipv6 will select hop limit */
-    ipv6->hl = data->hoplimit;
-    if (data->netif != NULL) {
+    if (data->iface != 0) {
         tmp = gnrc_netif_hdr_build(NULL, 0, NULL, 0);
         if (tmp == NULL) {
             DEBUG("error: packet buffer full\n");
             goto error_exit;
         }
-        gnrc_netif_hdr_set_netif(tmp->data, data->netif);
+        gnrc_netif_hdr_set_netif(tmp->data, gnrc_netif_get_by_pid(data->iface));
         LL_PREPEND(pkt, tmp);
     }
-    if (data->datalen >= sizeof(uint32_t)) {
-        *((uint32_t *)databuf) = xtimer_now_usec();
-    }
+    now = xtimer_now_usec();
+    memcpy(databuf, &now, sizeof(now));
     if (!gnrc_netapi_dispatch_send(GNRC_NETTYPE_IPV6,
                                    GNRC_NETREG_DEMUX_CTX_ALL,
                                    pkt)) {
         DEBUG("error: unable to send ICMPv6 echo request\n");
         goto error_exit;
     }
+    _sweep.pending++;
     return;
 error_exit:
     gnrc_pktbuf_release(pkt);
 }
 
-static void _print_reply(_ping_data_t *data, gnrc_pktsnip_t *icmpv6,
-                         ipv6_addr_t *from, unsigned hoplimit,
-                         gnrc_netif_hdr_t *netif_hdr)
+static void _print_reply(gnrc_pktsnip_t *icmpv6, ipv6_addr_t *from,
+                         unsigned hoplimit, gnrc_netif_hdr_t *netif_hdr)
 {
     icmpv6_echo_t *icmpv6_hdr = icmpv6->data;
     kernel_pid_t if_pid = netif_hdr ? netif_hdr->if_pid : KERNEL_PID_UNDEF;
     int16_t rssi = netif_hdr ? netif_hdr->rssi : 0;
 
     /* discard if too short*/
-    if (icmpv6->size < (data->datalen + sizeof(icmpv6_echo_t))) {
+    if (icmpv6->size < (DEFAULT_DATALEN + sizeof(icmpv6_echo_t))) {
         return;
     }
     if (icmpv6_hdr->type == ICMPV6_ECHO_REP) {
         char from_str[IPV6_ADDR_MAX_STR_LEN];
         const char *dupmsg = " (DUP!)";
-        uint32_t triptime = 0;
-        uint16_t recv_seq;
-        /* not our ping*/
-        if (byteorder_ntohs(icmpv6_hdr->id) != data->id) {
+        uint32_t triptime, sent;
+        uint16_t id = byteorder_ntohs(icmpv6_hdr->id);
+        uint16_t recv_seq = byteorder_ntohs(icmpv6_hdr->seq);
+        unsigned slot = id & 0xff;
+        _ping_data_t *data;
+
+        /* not our ping, or one of an earlier sweep */
+        if (((id >> 8) != _sweep.gen) ||
+            (slot >= CONFIG_DCA_NEIGHBOR_TABLE_SIZE) ||
+            !_neighbors[slot].active ||
+            (recv_seq >= _neighbors[slot].num_sent)) {
             return;
         }
-        if (!ipv6_addr_is_multicast(&data->host) &&
-            !ipv6_addr_equal(from, &data->host)) {
+        data = &_neighbors[slot];
+        if (!ipv6_addr_equal(from, &data->host)) {
             return;
         }
-        recv_seq = byteorder_ntohs(icmpv6_hdr->seq);
-        ipv6_addr_to_str(&from_str[0], from, sizeof(from_str));
-        if (data->datalen >= sizeof(uint32_t)) {
-            triptime = xtimer_now_usec() - *((uint32_t *)(icmpv6_hdr + 1));
-            data->tsum += triptime;
-            if (triptime < data->tmin) {
-                data->tmin = triptime;
-            }
-            if (triptime > data->tmax) {
-                data->tmax = triptime;
-            }
+        memcpy(&sent, icmpv6_hdr + 1, sizeof(sent));
+        triptime = xtimer_now_usec() - sent;
+        data->tsum += triptime;
+        if (triptime < data->tmin) {
+            data->tmin = triptime;
         }
-        if (bf_isset(data->cktab, recv_seq % CKTAB_SIZE)) {
+        if (triptime > data->tmax) {
+            data->tmax = triptime;
+        }
+        if (data->cktab & (1UL << recv_seq)) {
             data->num_rept++;
         }
         else {
-            bf_set(data->cktab, recv_seq % CKTAB_SIZE);
+            data->cktab |= 1UL << recv_seq;
             data->num_recv++;
+            /* Welford's update, the mean moves towards triptime without
+             * passing it, so m2 never decreases */
+            int64_t delta = (int64_t)triptime - data->mean;
+            data->mean += delta / data->num_recv;
+            data->m2 += delta * ((int64_t)triptime - data->mean);
+            if (_sweep.capacity) {
+                uint32_t *min = &data->size_min[recv_seq % CAPACITY_SIZES];
+                if (triptime < *min) {
+                    *min = triptime;
+                }
+            }
+            else {
+                /* the larger requests of capacity sweeps would skew it */
+                neighbor_table_add_rtt(&data->host, triptime);
+            }
+            _sweep.pending--;
             dupmsg += 7;
         }
+        if (IS_ACTIVE(ENABLE_DEBUG)) {
+            ipv6_addr_to_str(&from_str[0], from, sizeof(from_str));
+        }
         if (gnrc_netif_highlander() || (if_pid == KERNEL_PID_UNDEF) ||
             !ipv6_addr_is_link_local(from)) {
             DEBUG("%u bytes from %s: icmp_seq=%u ttl=%u",
@@ -323,15 +583,13 @@ static void _print_reply(_ping_data_t *data, gnrc_pktsnip_t *icmpv6,
         if (rssi) {
             DEBUG(" rssi=%" PRId16 " dBm", rssi);
         }
-        if (data->datalen >= sizeof(uint32_t)) {
-            DEBUG(" time=%lu.%03lu ms", (long unsigned)triptime / 1000,
-                  (long unsigned)triptime % 1000);
-        }
+        DEBUG(" time=%lu.%03lu ms", (long unsigned)triptime / 1000,
+              (long unsigned)triptime % 1000);
         DEBUG("%s\n", dupmsg);
     }
 }
 
-static void _handle_reply(_ping_data_t *data, gnrc_pktsnip_t *pkt)
+static void _handle_reply(gnrc_pktsnip_t *pkt)
 {
     gnrc_pktsnip_t *ipv6, *icmpv6, *netif;
     gnrc_netif_hdr_t *netif_hdr;
@@ -346,58 +604,106 @@ static void _handle_reply(_ping_data_t *data, gnrc_pktsnip_t *pkt)
     }
     ipv6_hdr = ipv6->data;
     netif_hdr = netif ? netif->data : NULL;
-    _print_reply(data, icmpv6, &ipv6_hdr->src, ipv6_hdr->hl, netif_hdr);
+    _print_reply(icmpv6, &ipv6_hdr->src, ipv6_hdr->hl, netif_hdr);
+    if ((_sweep.pending == 0) && (_probing() == 0)) {
+        /* all replies are in, no need to wait for the timeout */
+        _finish();
+    }
 }
 
-static int _finish(_ping_data_t *data)
+/* store the results of one neighbor, returns 1 if it did not answer */
+static int _finish_neighbor(_ping_data_t *data)
 {
-    struct neighbor_entryl *node = malloc(sizeof(struct neighbor_entryl));
-
     unsigned long tmp, nrecv, ndup;
+    uint32_t latency = 0;
+    uint32_t packet_loss = 0;
 
     tmp = data->num_sent;
     nrecv = data->num_recv;
     ndup = data->num_rept;
+    char hostname[IPV6_ADDR_MAX_STR_LEN];
+
+    ipv6_addr_to_str(hostname, &data->host, sizeof(hostname));
     DEBUG("\n--- %s statistics ---\n"
           "%lu packets transmitted, "
           "%lu packets received, ",
-          data->hostname, tmp, nrecv);
-    node->addr = data->host;
-    node->throughput = 0;
-    node->latency = 0;
-    node->packet_loss = 0;
-    node->next = NULL;
+          hostname, tmp, nrecv);
     if (ndup) {
         DEBUG("%lu duplicates, ", ndup);
     }
     if (tmp > 0) {
         tmp = ((tmp - nrecv) * 100) / tmp;
-        node->packet_loss = tmp;
+        packet_loss = tmp;
     }
-    if (data->tmin != UINT_MAX) {
+    if (data->tmin != UINT32_MAX) {
         unsigned tavg = data->tsum / (nrecv + ndup);
         DEBUG("round-trip min/avg/max = %u.%03u/%u.%03u/%u.%03u ms\n",
-              data->tmin / 1000, data->tmin % 1000,
+              (unsigned)data->tmin / 1000, (unsigned)data->tmin % 1000,
               tavg / 1000, tavg % 1000,
-              data->tmax / 1000, data->tmax % 1000);
+              (unsigned)data->tmax / 1000, (unsigned)data->tmax % 1000);
+        latency = tavg;
+    }
+    /* half of it is not the one-way delay on asymmetric links, see the
+     * delay probes in udp_throughput.c */
+    DEBUG("%s/ \n\trtt :%u.%03u ms\n\tpacket_loss:%lu%%\n", hostname,
+           (unsigned)(latency / 1000), (unsigned)(latency % 1000), tmp);
+    neighbor_table_update_latency(&data->host, latency, packet_loss,
+                                  data->num_sent);
+    /* if condition is true, count as 'failure' */
+    return (nrecv == 0);
+}
+
+/* Fit a line through the least round trip times over the payload sizes and
+ * store the capacity of the link to the neighbor, returns 1 if there is no
+ * estimate */
+static int _finish_capacity(_ping_data_t *data)
+{
+    int64_t n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    uint32_t capacity = 0;
+    uint32_t base_rtt = 0;
 
-        DEBUG("latency min/avg/max = %u.%03u/%u.%03u/%u.%03u ms\n",
-              data->tmin / 2000, ((data->tmin) / 2) % 1000,
-              tavg / 2000, (tavg / 2) % 1000,
-              data->tmax / 2000, ((data->tmax) / 2) % 1000);
-        node->latency = tavg;
+    for (unsigned i = 0; i < CAPACITY_SIZES; i++) {
+        if (data->size_min[i] == UINT32_MAX) {
+            continue;
+        }
+        int64_t x = _capacity_size(i);
+        int64_t y = data->size_min[i];
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
     }
-    DEBUG("%s/ \n\tlatency :%u.%03u ms\n\tpacket_loss:%lu%%\n", data->hostname,
-           (uint16_t)(node->latency / 2000), (uint16_t)(node->latency / 2) % 1000, tmp);
-    if (!linked_list_node_exists(&node->addr)) {
-        linked_list_update_latency(node);
+    /* least squares, the slope num / den is in us per byte */
+    int64_t den = n * sxx - sx * sx;
+    int64_t num = n * sxy - sx * sy;
+    if ((n >= 2) && (num > 0)) {
+        /* the payload crosses the link twice, in the request and the reply */
+        uint64_t bps = (2 * US_PER_SEC * (uint64_t)den) / (uint64_t)num;
+        int64_t base = (sy * sxx - sx * sxy) / den;
+        capacity = (bps > UINT32_MAX) ? UINT32_MAX : bps;
+        base_rtt = (base > 0) ? base : 0;
     }
-    else {
-        linked_list_insert_node(node);
+    DEBUG("latency: capacity %" PRIu32 " bytes/s, base rtt %" PRIu32 " us "
+          "from %u sizes\n", capacity, base_rtt, (unsigned)n);
+    neighbor_table_update_capacity(&data->host, capacity, base_rtt);
+    return (capacity == 0);
+}
+
+static void _finish(void)
+{
+    int failed = 0;
+
+    xtimer_remove(&_sweep.sched_timer);
+    for (unsigned slot = 0; slot < CONFIG_DCA_NEIGHBOR_TABLE_SIZE; slot++) {
+        if (_neighbors[slot].active) {
+            failed += _sweep.capacity ? _finish_capacity(&_neighbors[slot])
+                                      : _finish_neighbor(&_neighbors[slot]);
+            _neighbors[slot].active = false;
+        }
     }
-    xtimer_usleep(1000);
-    /* if condition is true, exit with 1 -- 'failure' */
-    return (nrecv == 0);
+    DEBUG("latency: %" PRIu32 " echo requests\n", _sweep.probes);
+    _done(failed);
 }
 
 #ifdef CONFIG_DCA_SHELL
@@ -409,9 +715,17 @@ int _latency(int argc, char **argv)
     return db_measure_network_latency();
 }
 
+int _capacity(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    return db_measure_network_capacity();
+}
+
 XFA_USE_CONST(shell_command_t *, shell_commands_xfa);
 
 shell_command_t _latency_cmd = { "dcalat", "Run DCA latency measurements", _latency };
+shell_command_t _capacity_cmd = { "dcacap", "Run DCA link capacity estimates", _capacity };
 
 XFA_ADD_PTR(
     shell_commands_xfa,
@@ -420,4 +734,11 @@ XFA_ADD_PTR(
     &_latency_cmd
     );
 
+XFA_ADD_PTR(
+    shell_commands_xfa,
+    0,
+    sc_dcacap,
+    &_capacity_cmd
+    );
+
 #endif /* defined(CONFIG_DCA_SHELL) */
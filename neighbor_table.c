@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  * @author  Divya Sasidharan <divya.sasidharan@st.ovgu.de>
+  * @author  Adarsh Raghoothaman <adarsh.raghoothaman@st.ovgu.de>
+  */
+#include "doriot_dca/neighbor_table.h"
+#include "doriot_dca/seqlock.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "atomic_utils.h"
+#include "bitarithm.h"
+#include "net/gnrc/ipv6/nib/nc.h"
+#include "xtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/* the used bitmap is kept in unsigned words for bitarithm */
+#define NEIGHBOR_TABLE_WORD_BITS (8 * sizeof(unsigned))
+#define NEIGHBOR_TABLE_WORDS \
+    ((CONFIG_DCA_NEIGHBOR_TABLE_SIZE + NEIGHBOR_TABLE_WORD_BITS - 1) / \
+     NEIGHBOR_TABLE_WORD_BITS)
+
+#if CONFIG_DCA_NEIGHBOR_TABLE_SIZE >= UINT8_MAX
+#error CONFIG_DCA_NEIGHBOR_TABLE_SIZE must be less than 255
+#endif
+
+typedef struct {
+    neighbor_entry_t entry;
+    /* next slot + 1 in the same hash bucket, 0 at the end */
+    uint8_t next;
+} _neighbor_slot_t;
+
+static _neighbor_slot_t _slots[CONFIG_DCA_NEIGHBOR_TABLE_SIZE];
+/* first slot + 1 of each hash bucket, 0 if empty */
+static uint8_t _buckets[CONFIG_DCA_NEIGHBOR_TABLE_SIZE];
+/* one bit per slot in use */
+static unsigned _used[NEIGHBOR_TABLE_WORDS];
+
+/* neighbors replaced because the table was full, and aged out */
+static uint32_t _evicted = 0;
+static uint32_t _expired = 0;
+
+/* Writers (measurements, netif) hold the write side while they look up or
+ * change entries, readers copy single entries. */
+static seqlock_t _lock = SEQLOCK_INIT;
+
+static inline int _is_used(unsigned slot)
+{
+    return (_used[slot / NEIGHBOR_TABLE_WORD_BITS] >>
+            (slot % NEIGHBOR_TABLE_WORD_BITS)) & 1;
+}
+
+static unsigned _hash(const ipv6_addr_t *addr)
+{
+    /* the interface identifiers of the neighbors differ the most */
+    uint32_t h = addr->u32[2].u32 ^ addr->u32[3].u32;
+    h *= 2654435761u;
+    return (h >> 16) % CONFIG_DCA_NEIGHBOR_TABLE_SIZE;
+}
+
+/* move avg towards val by CONFIG_DCA_EWMA_ALPHA / 256, starting at val */
+static void _ewma(uint32_t *avg, uint32_t val, bool first)
+{
+    if (val > NEIGHBOR_EWMA_MAX) {
+        /* the scaled value would wrap */
+        val = NEIGHBOR_EWMA_MAX;
+    }
+    int64_t target = (int64_t)val << NEIGHBOR_EWMA_SHIFT;
+
+    if (first) {
+        *avg = target;
+        return;
+    }
+    *avg += ((target - *avg) * CONFIG_DCA_EWMA_ALPHA) >> 8;
+}
+
+/* RFC 3550, 6.4.1: J += (|D| - J) / 16, with J scaled by 16 as in A.8 */
+static void _jitter(neighbor_entry_t *entry, uint32_t rtt)
+{
+    if (entry->last_rtt != 0) {
+        uint32_t d = (rtt > entry->last_rtt) ? rtt - entry->last_rtt
+                                             : entry->last_rtt - rtt;
+        entry->jitter += d - ((entry->jitter + (1U << (NEIGHBOR_JITTER_SHIFT - 1)))
+                              >> NEIGHBOR_JITTER_SHIFT);
+    }
+    entry->last_rtt = rtt;
+}
+
+/* returns the slot of addr, or -ENOENT; must hold the write lock */
+static int _find(const ipv6_addr_t *addr)
+{
+    for (uint8_t i = _buckets[_hash(addr)]; i != 0; i = _slots[i - 1].next) {
+        if (ipv6_addr_equal(&_slots[i - 1].entry.addr, addr)) {
+            return i - 1;
+        }
+    }
+    return -ENOENT;
+}
+
+/* remove slot from the table; must hold the write lock */
+static void _remove(unsigned slot)
+{
+    uint8_t *link = &_buckets[_hash(&_slots[slot].entry.addr)];
+    while (*link != slot + 1) {
+        assert(*link != 0);
+        link = &_slots[*link - 1].next;
+    }
+    *link = _slots[slot].next;
+    _used[slot / NEIGHBOR_TABLE_WORD_BITS] &=
+        ~(1U << (slot % NEIGHBOR_TABLE_WORD_BITS));
+}
+
+/* time since the neighbor was last seen in the neighbor cache or measured */
+static uint32_t _idle(const neighbor_entry_t *entry, uint32_t now)
+{
+    uint32_t seen = now - entry->seen;
+    uint32_t measured = now - entry->measured;
+    return (seen < measured) ? seen : measured;
+}
+
+/* returns a free slot, evicts the neighbor that has been idle the longest if
+ * the table is full; must hold the write lock */
+static unsigned _alloc(uint32_t now)
+{
+    unsigned oldest = 0;
+    uint32_t oldest_idle = 0;
+
+    for (unsigned i = 0; i < CONFIG_DCA_NEIGHBOR_TABLE_SIZE; i++) {
+        if (!_is_used(i)) {
+            return i;
+        }
+        uint32_t idle = _idle(&_slots[i].entry, now);
+        if (idle >= oldest_idle) {
+            oldest = i;
+            oldest_idle = idle;
+        }
+    }
+    DEBUG("neighbor_table: evicting slot %u\n", oldest);
+    _remove(oldest);
+    _evicted++;
+    return oldest;
+}
+
+/* returns the slot of addr, adds it if needed; must hold the write lock */
+static unsigned _find_or_add(const ipv6_addr_t *addr, uint32_t now)
+{
+    int slot = _find(addr);
+    if (slot >= 0) {
+        return slot;
+    }
+    slot = _alloc(now);
+    _neighbor_slot_t *s = &_slots[slot];
+    memset(&s->entry, 0, sizeof(s->entry));
+    s->entry.addr = *addr;
+    rtt_hist_init(&s->entry.rtt);
+    s->entry.seen = now;
+    s->entry.measured = now;
+    uint8_t *bucket = &_buckets[_hash(addr)];
+    s->next = *bucket;
+    *bucket = slot + 1;
+    _used[slot / NEIGHBOR_TABLE_WORD_BITS] |=
+        1U << (slot % NEIGHBOR_TABLE_WORD_BITS);
+    return slot;
+}
+
+int neighbor_table_seen(const ipv6_addr_t *addr)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    _slots[slot].entry.seen = now;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+unsigned neighbor_table_expire(uint32_t since, uint32_t grace)
+{
+    unsigned num = 0;
+    uint32_t now = xtimer_now_usec();
+
+    seqlock_write_begin(&_lock);
+    for (int slot = neighbor_table_next(0); slot >= 0;
+         slot = neighbor_table_next(slot + 1)) {
+        const neighbor_entry_t *entry = &_slots[slot].entry;
+        if (((int32_t)(entry->seen - since) < 0) &&
+            (now - entry->measured > grace)) {
+            DEBUG("neighbor_table: slot %d expired\n", slot);
+            _remove(slot);
+            num++;
+        }
+    }
+    _expired += num;
+    seqlock_write_end(&_lock);
+    return num;
+}
+
+/* The neighbors of all interfaces share the table, so the cache is synced
+ * as a whole */
+void neighbor_table_sync(void)
+{
+    void *state = NULL;
+    gnrc_ipv6_nib_nc_t nce;
+    uint32_t start = xtimer_now_usec();
+
+    while (gnrc_ipv6_nib_nc_iter(0, &state, &nce)) {
+        neighbor_table_seen(&nce.ipv6);
+    }
+    neighbor_table_expire(start, CONFIG_DCA_NEIGHBOR_GRACE_MS * US_PER_MS);
+}
+
+int neighbor_table_update_latency(const ipv6_addr_t *addr, uint32_t latency,
+                                  uint32_t packet_loss, uint32_t probes)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    neighbor_entry_t *entry = &_slots[slot].entry;
+    /* the averages of latencies and throughputs are never 0 once set */
+    if (latency != 0) {
+        _ewma(&entry->latency_avg, latency, entry->latency_avg == 0);
+    }
+    _ewma(&entry->packet_loss_avg, packet_loss, entry->latency_runs == 0);
+    entry->latency_runs++;
+    entry->latency = latency;
+    entry->packet_loss = packet_loss;
+    entry->probes = probes;
+    entry->measured = now;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_add_rtt(const ipv6_addr_t *addr, uint32_t rtt)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    rtt_hist_add(&_slots[slot].entry.rtt, rtt);
+    _jitter(&_slots[slot].entry, rtt);
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+/* must hold the write lock */
+static void _set_throughput(neighbor_entry_t *entry, uint32_t throughput,
+                            uint32_t now)
+{
+    if (throughput != 0) {
+        _ewma(&entry->throughput_avg, throughput, entry->throughput_avg == 0);
+    }
+    entry->throughput = throughput;
+    entry->measured = now;
+}
+
+int neighbor_table_update_throughput(const ipv6_addr_t *addr,
+                                     uint32_t throughput_tx,
+                                     uint32_t throughput_rx)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    _set_throughput(&_slots[slot].entry, throughput_tx, now);
+    _slots[slot].entry.throughput_rx = throughput_rx;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_update_bulk(const ipv6_addr_t *addr, uint32_t goodput,
+                               uint32_t sent, uint32_t lost,
+                               uint32_t reordered, uint32_t duplicates)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    neighbor_entry_t *entry = &_slots[slot].entry;
+    _set_throughput(entry, goodput, now);
+    entry->bulk_sent = sent;
+    entry->bulk_lost = lost;
+    entry->bulk_reordered = reordered;
+    entry->bulk_duplicates = duplicates;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_update_capacity(const ipv6_addr_t *addr, uint32_t capacity,
+                                   uint32_t base_rtt)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    neighbor_entry_t *entry = &_slots[slot].entry;
+    if (capacity != 0) {
+        entry->capacity = capacity;
+        entry->base_rtt = base_rtt;
+    }
+    entry->measured = now;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_update_bandwidth(const ipv6_addr_t *addr,
+                                    uint32_t bandwidth)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    if (bandwidth != 0) {
+        _slots[slot].entry.bandwidth = bandwidth;
+    }
+    _slots[slot].entry.measured = now;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_update_delay(const ipv6_addr_t *addr, uint32_t owd_fwd,
+                                uint32_t owd_rev, int32_t clock_offset)
+{
+    assert(addr);
+    uint32_t now = xtimer_now_usec();
+    seqlock_write_begin(&_lock);
+    unsigned slot = _find_or_add(addr, now);
+    neighbor_entry_t *entry = &_slots[slot].entry;
+    entry->owd_fwd = owd_fwd;
+    entry->owd_rev = owd_rev;
+    entry->clock_offset = clock_offset;
+    entry->measured = now;
+    seqlock_write_end(&_lock);
+    return slot;
+}
+
+int neighbor_table_get(unsigned slot, neighbor_entry_t *entry)
+{
+    assert(entry);
+    int used;
+    unsigned seq;
+
+    if (slot >= CONFIG_DCA_NEIGHBOR_TABLE_SIZE) {
+        return -ENOENT;
+    }
+    do {
+        seq = seqlock_read_begin(&_lock);
+        used = _is_used(slot);
+        *entry = _slots[slot].entry;
+    } while (seqlock_read_retry(&_lock, seq));
+    return used ? 0 : -ENOENT;
+}
+
+int neighbor_table_next(unsigned slot)
+{
+    while (slot < CONFIG_DCA_NEIGHBOR_TABLE_SIZE) {
+        /* the bits of the slots before slot are masked out */
+        unsigned bits = _used[slot / NEIGHBOR_TABLE_WORD_BITS] &
+                        (UINT_MAX << (slot % NEIGHBOR_TABLE_WORD_BITS));
+        slot -= slot % NEIGHBOR_TABLE_WORD_BITS;
+        if (bits != 0) {
+            return slot + bitarithm_lsb(bits);
+        }
+        slot += NEIGHBOR_TABLE_WORD_BITS;
+    }
+    return -ENOENT;
+}
+
+int32_t neighbor_table_get_num(void)
+{
+    unsigned num = 0;
+    for (unsigned i = 0; i < NEIGHBOR_TABLE_WORDS; i++) {
+        num += bitarithm_bits_set(_used[i]);
+    }
+    return num;
+}
+
+int32_t neighbor_table_get_evicted(void)
+{
+    return (int32_t)atomic_load_u32(&_evicted);
+}
+
+int32_t neighbor_table_get_expired(void)
+{
+    return (int32_t)atomic_load_u32(&_expired);
+}
@@ -9,7 +9,9 @@
   */
 
 #include "doriot_dca/netif.h"
+#include "doriot_dca/db_fl.h"
 
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <net/gnrc/netif.h>
@@ -36,7 +38,7 @@ typedef enum
     COUNT
 } device_property_t;
 
-static const char *field_names[COUNT] = {
+static const char *const field_names[COUNT] = {
     [DEVICE_NAME] = "pid",
     [ADDRESS] = "inet6 addr",
     [LINK_TYPE] = "Link type",
@@ -49,27 +51,81 @@ typedef enum
     LATENCY,
     PACKET_LOSS,
     THROUGHPUT,
+    THROUGHPUT_TX,
+    THROUGHPUT_RX,
+    CAPACITY,
+    BASE_RTT,
+    BANDWIDTH,
+    RTT,
+    OWD_FWD,
+    OWD_REV,
+    CLOCK_OFFSET,
+    LATENCY_AVG,
+    RTT_AVG,
+    PACKET_LOSS_AVG,
+    THROUGHPUT_AVG,
+    JITTER,
+    RTT_MIN,
+    RTT_MAX,
+    RTT_P50,
+    RTT_P90,
+    RTT_P99,
+    RTT_SAMPLES,
+    PROBES,
+    BULK_SENT,
+    BULK_LOST,
+    BULK_REORDERED,
+    BULK_DUPLICATES,
     QOS_COUNT
 } qos_property_t;
 
-static const char *sub_field_names[QOS_COUNT] = {
+static const char *const sub_field_names[QOS_COUNT] = {
     [NEIGH_ADDR] = "ip",
     [LATENCY] = "latency",
     [PACKET_LOSS] = "packet_loss",
-    [THROUGHPUT] = "throughput"};
+    [THROUGHPUT] = "throughput",
+    [THROUGHPUT_TX] = "throughput_tx",
+    [THROUGHPUT_RX] = "throughput_rx",
+    [CAPACITY] = "capacity",
+    [BASE_RTT] = "base_rtt",
+    [BANDWIDTH] = "bandwidth",
+    [RTT] = "rtt",
+    [OWD_FWD] = "owd_fwd",
+    [OWD_REV] = "owd_rev",
+    [CLOCK_OFFSET] = "clock_offset",
+    [LATENCY_AVG] = "latency_avg",
+    [RTT_AVG] = "rtt_avg",
+    [PACKET_LOSS_AVG] = "packet_loss_avg",
+    [THROUGHPUT_AVG] = "throughput_avg",
+    [JITTER] = "jitter",
+    [RTT_MIN] = "rtt_min",
+    [RTT_MAX] = "rtt_max",
+    [RTT_P50] = "rtt_p50",
+    [RTT_P90] = "rtt_p90",
+    [RTT_P99] = "rtt_p99",
+    [RTT_SAMPLES] = "rtt_samples",
+    [PROBES] = "probes",
+    [BULK_SENT] = "bulk_sent",
+    [BULK_LOST] = "bulk_lost",
+    [BULK_REORDERED] = "bulk_reordered",
+    [BULK_DUPLICATES] = "bulk_duplicates"};
 #define FIELD_NAME_UNKNOWN "unknown"
 
 typedef struct
 {
-    /* The iface that the node represents */
+    /* root: next iface to return; otherwise: the iface represented */
     netif_t *iface;
-    /* 1: firstlevel branch root, 0: leaf node */
+    /* 4: firstlevel branch root, 3: iface, 2: iface field, 1: neighbour,
+     * 0: neighbour field */
     uint8_t is_root;
+    /* iface and neighbour: next field to return; fields: the field
+     * represented */
+    uint8_t field;
+    /* neighbours field: slot to look for the next neighbour from;
+     * neighbour and its fields: the slot of the neighbour represented */
+    uint8_t neigh;
 } _db_netif_node_private_data_t;
 
-uint8_t _netif_field_count = 0;
-uint8_t _netif_sub_field_count = 1;
-uint8_t _num_neighbours = 0;
 char *_netif_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
 int _netif_node_getnext_child(db_node_t *node, db_node_t *next_child);
 int _netif_node_getnext(db_node_t *node, db_node_t *next);
@@ -78,15 +134,11 @@ size_t _netif_node_getsize(const db_node_t *node);
 size_t _netif_node_getstr_value(const db_node_t *node, char *value, size_t bufsize);
 int32_t _netif_node_getint_value(const db_node_t *node);
 float _netif_node_getfloat_value(const db_node_t *node);
-char *_netif_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
-char *_netif_node_get_sub_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
-float _netif_get_latency(uint8_t _num_neighbours, uint8_t _netif_sub_field_count);
-float _netif_get_throughput(uint8_t _num_neighbours, uint8_t _netif_sub_field_count);
-float _netif_get_packetloss(uint8_t _num_neighbours, uint8_t _netif_sub_field_count);
-int _netif_get_ip(uint8_t _num_neighbours, char *addr_str);
-int _netif_node_add_list(ipv6_addr_t *ip_addr);
+int _netif_get_ip(uint8_t neigh, char addr_str[IPV6_ADDR_MAX_STR_LEN]);
+int _netif_node_find_child(const db_node_t *node, const char *name, size_t len,
+                           db_node_t *child);
 
-static db_node_ops_t _db_netif_node_ops = {
+static const db_node_ops_t _db_netif_node_ops = {
     .get_name_fn = _netif_node_getname,
     .get_next_child_fn = _netif_node_getnext_child,
     .get_next_fn = _netif_node_getnext,
@@ -95,10 +147,12 @@ static db_node_ops_t _db_netif_node_ops = {
     .get_int_value_fn = _netif_node_getint_value,
     .get_float_value_fn = _netif_node_getfloat_value,
     .get_str_value_fn = _netif_node_getstr_value,
+    .find_child_fn = _netif_node_find_child,
 };
 
 /* netif node constructor */
-void _netif_node_init(db_node_t *node, netif_t *iface, uint8_t is_root)
+void _netif_node_init(db_node_t *node, netif_t *iface, uint8_t is_root,
+                      uint8_t field, uint8_t neigh)
 {
     node->ops = &_db_netif_node_ops;
     memset(node->private_data.u8, 0, DB_NODE_PRIVATE_DATA_MAX);
@@ -106,16 +160,23 @@ void _netif_node_init(db_node_t *node, netif_t *iface, uint8_t is_root)
         (_db_netif_node_private_data_t *)node->private_data.u8;
     private_data->iface = iface;
     private_data->is_root = is_root;
+    private_data->field = field;
+    private_data->neigh = neigh;
 }
 
 void db_new_netif_node(db_node_t *node)
 {
     assert(node);
     assert(sizeof(_db_netif_node_private_data_t) <= DB_NODE_PRIVATE_DATA_MAX);
-    _netif_field_count = 0;
-    _netif_sub_field_count = 1;
     netif_t *iface = netif_iter(NULL);
-    _netif_node_init(node, iface, 4u);
+    _netif_node_init(node, iface, 4u, 0u, 0u);
+}
+
+/* returns 1 if there is a neighbour in slot neigh */
+static int _netif_neigh_exists(uint8_t neigh)
+{
+    neighbor_entry_t entry;
+    return neighbor_table_get(neigh, &entry) == 0;
 }
 
 char *_netif_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
@@ -124,27 +185,28 @@ char *_netif_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
     assert(name);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 4u)
-    {
-        strncpy(name, "netif", DB_NODE_NAME_MAX);
-    }
-    else if (private_data->is_root == 3u)
+    switch (private_data->is_root)
     {
+    case 4u:
+        strncpy(name, db_str(DB_STR(netif)), DB_NODE_NAME_MAX);
+        break;
+    case 3u:
         assert(private_data->iface != NULL);
         netif_get_name(private_data->iface, name);
-    }
-    else if (private_data->is_root == 2u && _netif_field_count < COUNT)
-    {
-        strncpy(name, _netif_node_get_field_name(node, name), DB_NODE_NAME_MAX);
-    }
-    else if (private_data->is_root == 1u)
-    {
-        _netif_get_ip(_num_neighbours, name);
-        DEBUG("_num_neighbours:%d,%s\n", _num_neighbours, name);
-    }
-    else if (private_data->is_root == 0u && _netif_sub_field_count <= QOS_COUNT)
-    {
-        strncpy(name, _netif_node_get_sub_field_name(node, name), DB_NODE_NAME_MAX);
+        break;
+    case 2u:
+        assert(private_data->field < COUNT);
+        strncpy(name, field_names[private_data->field], DB_NODE_NAME_MAX);
+        break;
+    case 1u:
+        /* neighbours are named by their slot in the neighbor table, see the
+         * ip field for the address, which does not fit into DB_NODE_NAME_MAX */
+        name[fmt_u32_dec(name, private_data->neigh)] = '\0';
+        break;
+    default:
+        assert(private_data->field < QOS_COUNT);
+        strncpy(name, sub_field_names[private_data->field], DB_NODE_NAME_MAX);
+        break;
     }
     return name;
 }
@@ -155,117 +217,38 @@ int _netif_node_getnext_child(db_node_t *node, db_node_t *next_child)
     assert(next_child);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 4u)
+    int slot;
+    if (private_data->is_root == 4u && private_data->iface != NULL)
     {
         /* return child node representing iface, advance own iface */
-        if (private_data->iface != NULL)
-        {
-            _netif_node_init(next_child, private_data->iface, 3u);
-            private_data->iface = netif_iter(private_data->iface);
-        }
-        else
-        {
-            /* end of iface list */
-            db_node_set_null(next_child);
-        }
+        _netif_node_init(next_child, private_data->iface, 3u, 0u, 0u);
+        private_data->iface = netif_iter(private_data->iface);
     }
-    else if (private_data->is_root == 3u)
+    else if (private_data->is_root == 3u && private_data->field < COUNT)
     {
-        if (private_data->iface != NULL && _netif_field_count < COUNT)
-        {
-            _netif_node_init(next_child, private_data->iface, 2u);
-            private_data->iface = netif_iter(private_data->iface);
-            private_data->is_root = 2u;
-        }
+        /* return next field of the iface, advance own field */
+        _netif_node_init(next_child, private_data->iface, 2u,
+                         private_data->field, 0u);
+        private_data->field++;
     }
-    else if (private_data->is_root == 2u)
+    else if (private_data->is_root == 2u && private_data->field == NEIGH &&
+             (slot = neighbor_table_next(private_data->neigh)) >= 0)
     {
-        if (_netif_field_count == COUNT - 1 && private_data->iface != NULL && _num_neighbours > 0)
-        {
-            _netif_node_init(next_child, private_data->iface, 1u);
-            private_data->is_root = 1u;
-            _netif_sub_field_count++;
-        }
-        else if (_netif_field_count < COUNT - 1)
-        {
-            _netif_field_count++;
-        }
-        else
-        {
-            /* end of iface list */
-            db_node_set_null(next_child);
-        }
+        /* return next neighbour, advance own neighbour */
+        _netif_node_init(next_child, private_data->iface, 1u, 0u, slot);
+        private_data->neigh = slot + 1;
     }
-    else if (private_data->is_root == 1u)
+    else if (private_data->is_root == 1u && private_data->field < QOS_COUNT)
     {
-        if (_num_neighbours <= 0)
-        {
-            /*reset _netif_sub_field_count*/
-            _netif_sub_field_count = 1;
-            db_node_set_null(next_child);
-        }
-        else if (_netif_sub_field_count == 1)
-        {
-            /*iterating sub field*/
-            _netif_node_init(next_child, private_data->iface, 1u);
-            private_data->is_root = 1u;
-            _netif_sub_field_count++;
-        }
-        else if (_netif_sub_field_count < QOS_COUNT)
-        {
-            /*init leaf nodes for neighbor information*/
-            _netif_node_init(next_child, private_data->iface, 0u);
-            private_data->is_root = 0u;
-        }
-        else
-        {
-            _num_neighbours--;            
-            if (_num_neighbours == 0) 
-            {
-                /* end of neighbor information*/
-                _netif_sub_field_count = 1;
-                db_node_set_null(next_child);
-            }
-            else
-            {
-                /* recursive call to access next neighbor ip*/
-                _netif_sub_field_count = 1;
-                private_data->is_root = 1u;
-                _netif_node_getnext_child(node, next_child);
-            }
-        }
+        /* return next field of the neighbour, advance own field */
+        _netif_node_init(next_child, private_data->iface, 0u,
+                         private_data->field, private_data->neigh);
+        private_data->field++;
     }
-    else if (private_data->is_root == 0u)
-    {        
-        if (_netif_sub_field_count < QOS_COUNT)
-        {
-            /*iterate leaf nodes for neighbor information*/
-            _netif_sub_field_count++;
-            private_data->is_root = 0u;
-        }
-        else if (_netif_sub_field_count == QOS_COUNT && _num_neighbours != 0)
-        {
-            /* end of neighbor information for current node*/
-            _netif_sub_field_count++;
-            db_node_set_null(next_child);
-        }
-        else
-        {
-            _num_neighbours--;
-            if (_num_neighbours == 0) 
-            {
-                /* end of neighbor information*/
-                _netif_sub_field_count = 1;
-                db_node_set_null(next_child);
-            }
-            else
-            {
-                /* recursive call to access next neighbor ip*/
-                _netif_sub_field_count = 1;
-                private_data->is_root = 1u;
-                _netif_node_getnext_child(node, next_child);
-            }
-        }
+    else
+    {
+        /* end of list or leaf node */
+        db_node_set_null(next_child);
     }
     return 0;
 }
@@ -276,47 +259,30 @@ int _netif_node_getnext(db_node_t *node, db_node_t *next)
     assert(next);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 4u)
+    netif_t *iface = private_data->iface;
+    uint8_t field = private_data->field + 1;
+    int slot;
+    if (private_data->is_root == 3u && (iface = netif_iter(iface)) != NULL)
     {
-        /* this branch root node has no neighbor */
-        db_node_set_null(next);
+        _netif_node_init(next, iface, 3u, 0u, 0u);
     }
-    else if (private_data->is_root == 3u)
+    else if (private_data->is_root == 2u && field < COUNT)
     {
-        /* this branch root node has no neighbor */
-        netif_t *iface = netif_iter(private_data->iface);
-        if (private_data->iface != NULL)
-        {
-            _netif_node_init(next, iface, 2u);
-        }
-        else
-        {
-            /* end of processes list */
-            db_node_set_null(next);
-        }
+        _netif_node_init(next, iface, 2u, field, 0u);
     }
-    else if (private_data->is_root == 1u)
+    else if (private_data->is_root == 1u &&
+             (slot = neighbor_table_next(private_data->neigh + 1)) >= 0)
     {
-        /* this branch root node has no neighbor */
-        netif_t *iface = netif_iter(private_data->iface);
-        if (private_data->iface != NULL)
-        {
-            _netif_node_init(next, iface, 1u);
-        }
+        _netif_node_init(next, iface, 1u, 0u, slot);
+    }
+    else if (private_data->is_root == 0u && field < QOS_COUNT)
+    {
+        _netif_node_init(next, iface, 0u, field, private_data->neigh);
     }
     else
     {
-        /* retrieve the next child (leaf) node */
-        netif_t *iface = netif_iter(private_data->iface);
-        if (private_data->iface != NULL)
-        {
-            _netif_node_init(next, iface, 2u);
-        }
-        else
-        {
-            /* end of processes list */
-            db_node_set_null(next);
-        }
+        /* branch root has no neighbor, or end of list */
+        db_node_set_null(next);
     }
     return 0;
 }
@@ -326,48 +292,39 @@ db_node_type_t _netif_node_gettype(const db_node_t *node)
     assert(node);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 4u)
+    if (private_data->is_root == 2u)
     {
-        return db_node_type_inner;
-    }
-    else if (private_data->is_root == 3u)
-    {
-        return db_node_type_inner;
-    }
-    /* for pid  and number of neighbors*/
-    else if (_netif_field_count == 0 || _netif_field_count == 3)
-    {
-        return db_node_type_int;
-    }
-    /* for own address */
-    else if (private_data->is_root == 2u && _netif_field_count == 1)
-    {
-        return db_node_type_str;
-    }
-    /* for link type */
-    else if (private_data->is_root == 2u && _netif_field_count == 2)
-    {
-        return db_node_type_str;
-    }
-    /* for inner node */
-    else if (private_data->is_root == 2u && _netif_field_count == 4)
-    {
-        return db_node_type_inner;
-    }
-    /* for ip inner node*/
-    else if (private_data->is_root == 1u)
-    {
-        return db_node_type_inner;
-    }
-    /* for latency, packet loss,throughput  */
-    else if (_netif_sub_field_count == 2 || _netif_sub_field_count == 3 || _netif_sub_field_count == 4)
-    {
-        return db_node_type_float;
+        switch (private_data->field)
+        {
+        case DEVICE_NAME:
+        case NUM_NEIGH:
+            return db_node_type_int;
+        case ADDRESS:
+        case LINK_TYPE:
+            return db_node_type_str;
+        default:
+            return db_node_type_inner;
+        }
     }
-    else
+    else if (private_data->is_root == 0u)
     {
-        return db_node_type_str;
+        switch (private_data->field)
+        {
+        case NEIGH_ADDR:
+            return db_node_type_str;
+        case RTT_SAMPLES:
+        case PROBES:
+        case BULK_SENT:
+        case BULK_LOST:
+        case BULK_REORDERED:
+        case BULK_DUPLICATES:
+            return db_node_type_int;
+        default:
+            return db_node_type_float;
+        }
     }
+    /* root, iface and neighbour */
+    return db_node_type_inner;
 }
 
 int _netif_get_ipv6_addr(netif_t *iface, char addr[IPV6_ADDR_MAX_STR_LEN])
@@ -402,60 +359,34 @@ int _netif_get_link_type(netif_t *iface, char link[10])
     }
 }
 
-int _netif_get_ip(uint8_t _num_neighbours, char *addr_str)
-{
-    linked_list_read_ip(_num_neighbours, addr_str);
-    return strnlen(addr_str, IPV6_ADDR_MAX_STR_LEN);
-}
 
-float _netif_get_latency(uint8_t _num_neighbours, uint8_t _netif_sub_field_count)
+int _netif_get_ip(uint8_t neigh, char addr_str[IPV6_ADDR_MAX_STR_LEN])
 {
-    int32_t lat = (linked_list_read(_netif_sub_field_count, _num_neighbours));
-    return lat/2000.0f;
-}
-
-
-float _netif_get_packetloss(uint8_t _num_neighbours, uint8_t _netif_sub_field_count)
-{
-    int32_t val = (linked_list_read(_netif_sub_field_count, _num_neighbours));
-    return (float) val;
-}
-
-float _netif_get_throughput(uint8_t _num_neighbours, uint8_t _netif_sub_field_count)
-{
-    int32_t val = (linked_list_read(_netif_sub_field_count, _num_neighbours));
-    return (float) val;
+    neighbor_entry_t entry;
+    if (neighbor_table_get(neigh, &entry) != 0)
+    {
+        addr_str[0] = '\0';
+        return 0;
+    }
+    ipv6_addr_to_str(addr_str, &entry.addr, IPV6_ADDR_MAX_STR_LEN);
+    return strnlen(addr_str, IPV6_ADDR_MAX_STR_LEN);
 }
 
 size_t _netif_node_getsize(const db_node_t *node)
 {
     assert(node);
-    _db_netif_node_private_data_t *private_data =
-        (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 4u)
-    {
-        return 2u;
-    }
-    else if (private_data->is_root == 3u)
-    {
-        return 2u;
-    }
-    /* for number of neighbors*/
-    else if (private_data->is_root == 2u && _netif_field_count == 2)
+    char value[IPV6_ADDR_MAX_STR_LEN];
+    switch (_netif_node_gettype(node))
     {
+    case db_node_type_int:
         return sizeof(int32_t);
-    }
-    /* for packet latency, loss, throughput */
-    else if (private_data->is_root == 0u && _netif_sub_field_count < QOS_COUNT)
-    {
+    case db_node_type_float:
         return sizeof(float);
+    case db_node_type_str:
+        return _netif_node_getstr_value(node, value, sizeof(value));
+    default:
+        return 0u;
     }
-    else
-    {
-        char addr[IPV6_ADDR_MAX_STR_LEN];
-        return _netif_get_ipv6_addr(private_data->iface, addr);
-    }
-    return 2u;
 }
 
 size_t _netif_node_getstr_value(const db_node_t *node, char *value, size_t bufsize)
@@ -463,23 +394,31 @@ size_t _netif_node_getstr_value(const db_node_t *node, char *value, size_t bufsi
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
     assert(private_data->iface != NULL);
-    (void)bufsize;
-    /* for own ip*/
-    if (_netif_field_count == 1)
+    char str[IPV6_ADDR_MAX_STR_LEN];
+    int len = 0;
+    if (private_data->is_root == 2u && private_data->field == ADDRESS)
+    {
+        len = _netif_get_ipv6_addr(private_data->iface, str);
+    }
+    else if (private_data->is_root == 2u && private_data->field == LINK_TYPE)
     {
-        return (int32_t)_netif_get_ipv6_addr(private_data->iface, value);
+        len = _netif_get_link_type(private_data->iface, str);
     }
-    /* for link type*/
-    else if (_netif_field_count == 2)
+    else if (private_data->is_root == 0u && private_data->field == NEIGH_ADDR)
     {
-        return (int32_t)_netif_get_link_type(private_data->iface, value);
+        len = _netif_get_ip(private_data->neigh, str);
     }
-    /* for ip*/
-    else if (_netif_sub_field_count == 1)
+    if (bufsize == 0)
     {
-        return (int32_t)_netif_get_ip(_num_neighbours, value);
+        return 0;
     }
-    return 88;
+    if ((size_t)len >= bufsize)
+    {
+        len = bufsize - 1;
+    }
+    memcpy(value, str, len);
+    value[len] = '\0';
+    return len;
 }
 
 float _netif_node_getfloat_value(const db_node_t *node) {
@@ -487,116 +426,195 @@ float _netif_node_getfloat_value(const db_node_t *node) {
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
     assert(private_data->iface != NULL);
-    /* for latency*/
-    if (_netif_sub_field_count == 2)
-    {
-        return (int32_t)_netif_get_latency(_num_neighbours, _netif_sub_field_count);
-    }
-    /* for packetloss*/
-    else if (_netif_sub_field_count == 3)
-    {
-        return (int32_t)_netif_get_packetloss(_num_neighbours, _netif_sub_field_count);
-    }
-    /* for throughput*/
-    else if (_netif_sub_field_count == 4)
-    {
-        return (int32_t)_netif_get_throughput(_num_neighbours, _netif_sub_field_count);
+    neighbor_entry_t entry;
+    if (neighbor_table_get(private_data->neigh, &entry) != 0)
+    {
+        return 0.0f;
+    }
+    switch (private_data->field)
+    {
+    /* deprecated: half the round trip time in ms, which is not the one-way
+     * delay on asymmetric links; use rtt or owd_fwd and owd_rev */
+    case LATENCY:
+        return entry.latency / 2000.0f;
+    case PACKET_LOSS:
+        return (float)entry.packet_loss;
+    /* throughput is throughput_tx, kept for existing readers */
+    case THROUGHPUT:
+    case THROUGHPUT_TX:
+        return (float)entry.throughput;
+    case THROUGHPUT_RX:
+        return (float)entry.throughput_rx;
+    case CAPACITY:
+        return (float)entry.capacity;
+    case BASE_RTT:
+        return entry.base_rtt / 1000.0f;
+    case BANDWIDTH:
+        return (float)entry.bandwidth;
+    /* round trip time of the echo requests, in ms */
+    case RTT:
+        return entry.latency / 1000.0f;
+    /* one-way delays and the clock offset of the neighbor, in ms */
+    case OWD_FWD:
+        return entry.owd_fwd / 1000.0f;
+    case OWD_REV:
+        return entry.owd_rev / 1000.0f;
+    case CLOCK_OFFSET:
+        return entry.clock_offset / 1000.0f;
+    /* moving averages, in the units of the last values */
+    case LATENCY_AVG:
+        /* deprecated like latency */
+        return entry.latency_avg / (2000.0f * (1U << NEIGHBOR_EWMA_SHIFT));
+    case RTT_AVG:
+        return entry.latency_avg / (1000.0f * (1U << NEIGHBOR_EWMA_SHIFT));
+    case PACKET_LOSS_AVG:
+        return entry.packet_loss_avg / (float)(1U << NEIGHBOR_EWMA_SHIFT);
+    case THROUGHPUT_AVG:
+        return entry.throughput_avg / (float)(1U << NEIGHBOR_EWMA_SHIFT);
+    case JITTER:
+        /* of the round trip times, in ms */
+        return entry.jitter / (1000.0f * (1U << NEIGHBOR_JITTER_SHIFT));
+    /* round trip times in ms */
+    case RTT_MIN:
+        return entry.rtt.samples ? entry.rtt.min / 1000.0f : 0.0f;
+    case RTT_MAX:
+        return entry.rtt.max / 1000.0f;
+    case RTT_P50:
+        return rtt_hist_percentile(&entry.rtt, 50) / 1000.0f;
+    case RTT_P90:
+        return rtt_hist_percentile(&entry.rtt, 90) / 1000.0f;
+    case RTT_P99:
+        return rtt_hist_percentile(&entry.rtt, 99) / 1000.0f;
+    default:
+        return 0.0f;
     }
-    return 0.0;
 }
 
-char *_netif_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX])
+int32_t _netif_node_getint_value(const db_node_t *node)
 {
-    assert(node);
-    assert(name);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    assert(private_data->iface != NULL);
-    switch (_netif_field_count)
+    if (private_data->is_root == 0u)
     {
-    case 0:
-        strncpy(name, field_names[DEVICE_NAME], DB_NODE_NAME_MAX);
-        break;
-    case 1:
-        strncpy(name, field_names[ADDRESS], DB_NODE_NAME_MAX);
-        break;
-    case 2:
-        strncpy(name, field_names[LINK_TYPE], DB_NODE_NAME_MAX);
-        break;
-    case 3:
-        strncpy(name, field_names[NUM_NEIGH], DB_NODE_NAME_MAX);
-        break;
-    case 4:
-        strncpy(name, field_names[NEIGH], DB_NODE_NAME_MAX);
-        break;
-    default:
-        break;
+        neighbor_entry_t entry;
+        if (neighbor_table_get(private_data->neigh, &entry) != 0)
+        {
+            return 0;
+        }
+        switch (private_data->field)
+        {
+        case RTT_SAMPLES:
+            return (int32_t)entry.rtt.samples;
+        case PROBES:
+            return (int32_t)entry.probes;
+        case BULK_SENT:
+            return (int32_t)entry.bulk_sent;
+        case BULK_LOST:
+            return (int32_t)entry.bulk_lost;
+        case BULK_REORDERED:
+            return (int32_t)entry.bulk_reordered;
+        case BULK_DUPLICATES:
+            return (int32_t)entry.bulk_duplicates;
+        default:
+            return 0;
+        }
+    }
+    else if (private_data->field == DEVICE_NAME)
+    {
+        return (int32_t)netif_get_id(private_data->iface);
+    }
+    else if (private_data->field == NUM_NEIGH)
+    {
+        /* the neighbours listed below, of all interfaces */
+        return neighbor_table_get_num();
+    }
+    else
+    {
+        return -1;
     }
-    return name;
 }
 
-char *_netif_node_get_sub_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX])
+/* returns the index of field name in names, or -1 */
+static int _netif_find_name(const char *const *names, unsigned num,
+                            const char *name, size_t len)
 {
-    assert(node);
-    assert(name);
-    DEBUG("--_netif_sub_field_count == %d--\n", _netif_sub_field_count);
-    switch (_netif_sub_field_count)
+    for (unsigned i = 0; i < num; i++)
     {
-    case 1:
-        strncpy(name, sub_field_names[NEIGH_ADDR], DB_NODE_NAME_MAX);
-        break;
-    case 2:
-        strncpy(name, sub_field_names[LATENCY], DB_NODE_NAME_MAX);
-        break;
-    case 3:
-        strncpy(name, sub_field_names[PACKET_LOSS], DB_NODE_NAME_MAX);
-        break;
-    case 4:
-        strncpy(name, sub_field_names[THROUGHPUT], DB_NODE_NAME_MAX);
-        break;
-    default:
-        break;
+        if (strncmp(names[i], name, len) == 0 && names[i][len] == '\0')
+        {
+            return i;
+        }
     }
-    return name;
+    return -1;
 }
 
-int32_t _netif_node_getint_value(const db_node_t *node)
+int _netif_node_find_child(const db_node_t *node, const char *name, size_t len,
+                           db_node_t *child)
 {
+    assert(node);
+    assert(child);
     _db_netif_node_private_data_t *private_data =
         (_db_netif_node_private_data_t *)node->private_data.u8;
-    if (_netif_field_count == 0)
+    int idx;
+    switch (private_data->is_root)
     {
-        return (int32_t)netif_get_id(private_data->iface);
-    }
-    else if (_netif_field_count == 3)
+    case 4u:
     {
-        void *state = NULL;
-        gnrc_ipv6_nib_nc_t nce;
-        _num_neighbours = 0;
-        while (gnrc_ipv6_nib_nc_iter((int32_t)netif_get_id(private_data->iface), &state, &nce))
+        /* look up the interface by its name */
+        char if_name[NETIF_NAMELENMAX];
+        for (netif_t *iface = netif_iter(NULL); iface != NULL; iface = netif_iter(iface))
         {
-            _num_neighbours++;
-            _netif_node_add_list(&nce.ipv6);
+            int if_name_len = netif_get_name(iface, if_name);
+            if (if_name_len >= 0 && (size_t)if_name_len == len &&
+                memcmp(if_name, name, len) == 0)
+            {
+                _netif_node_init(child, iface, 3u, 0u, 0u);
+                return 0;
+            }
         }
-        return _num_neighbours;
+        break;
     }
-    else
+    case 3u:
+        if ((idx = _netif_find_name(field_names, COUNT, name, len)) >= 0)
+        {
+            _netif_node_init(child, private_data->iface, 2u, idx, 0u);
+            return 0;
+        }
+        break;
+    case 2u:
     {
-        return -1;
+        /* neighbours are named by their slot */
+        size_t digits = 0;
+        while (digits < len && name[digits] >= '0' && name[digits] <= '9')
+        {
+            digits++;
+        }
+        uint32_t neigh = scn_u32_dec(name, len);
+        if (private_data->field == NEIGH && len > 0 && len <= 3 &&
+            digits == len && neigh <= UINT8_MAX && _netif_neigh_exists(neigh))
+        {
+            _netif_node_init(child, private_data->iface, 1u, 0u, neigh);
+            return 0;
+        }
+        break;
     }
+    case 1u:
+        if ((idx = _netif_find_name(sub_field_names, QOS_COUNT, name, len)) >= 0)
+        {
+            _netif_node_init(child, private_data->iface, 0u, idx,
+                             private_data->neigh);
+            return 0;
+        }
+        break;
+    default:
+        break;
+    }
+    return -ENOENT;
 }
 
-int _netif_node_add_list(ipv6_addr_t *ip_addr)
+#if CONFIG_DCA_SAMPLER
+void db_sample_netif(void)
 {
-    if (linked_list_node_exists(ip_addr))
-    {
-        struct neighbor_entryl *node = malloc(sizeof(struct neighbor_entryl));
-        node->addr = *ip_addr;
-        node->latency = 0;
-        node->packet_loss = 0;
-        node->throughput = 0;
-        node->next = NULL;
-        linked_list_insert_node(node);
-    }
-    return 0;
+    neighbor_table_sync();
 }
+#endif /* CONFIG_DCA_SAMPLER */
@@ -9,13 +9,18 @@
   */
 
 #include "doriot_dca/ps.h"
+#include "doriot_dca/db_cache.h"
+#include "doriot_dca/db_fl.h"
 
+#include <errno.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <thread.h>
 #include <string.h>
 
 #include "sched.h"
+#include "xtimer.h"
 
 #define ENABLE_DEBUG (0)
 #include "debug.h"
@@ -30,7 +35,7 @@ typedef enum
     COUNT
 } thread_property_t;
 
-static const char *field_names[COUNT] = {
+static const char *const field_names[COUNT] = {
     [PID] = "pid",
     [STATE] = "state",
     [PRIORITY] = "priority",
@@ -40,7 +45,7 @@ static const char *field_names[COUNT] = {
 
 #define FIELD_NAME_UNKNOWN "unknown"
 
-static const char *state_names[STATUS_NUMOF] = {
+static const char *const state_names[STATUS_NUMOF] = {
     [STATUS_STOPPED] = "stopped",
     [STATUS_ZOMBIE] = "zombie",
     [STATUS_SLEEPING] = "sleeping",
@@ -59,25 +64,36 @@ static const char *state_names[STATUS_NUMOF] = {
 
 typedef struct
 {
-    /* The pid that the node represents */
+    /* root: next process to return; otherwise: the process represented */
     kernel_pid_t pid;
     /* 2: firstlevel branch root,1: secondlevel branch root, 0: leaf node*/
     uint8_t is_root;
-
+    /* process: next field to return; leaf: the field represented */
+    uint8_t field;
 } _db_ps_node_private_data_t;
 
-int8_t _field_count = 0;
+#if CONFIG_DCA_SAMPLER || (CONFIG_DCA_STACK_USED_TTL_MS > 0)
+#define PS_CACHE_STACK_USED
+/* stack used per pid, filled by the sampler and by reads */
+static db_cache_entry_t _stack_used_cache[KERNEL_PID_LAST + 1];
+/* zero is the unlocked state */
+static seqlock_t _stack_used_lock;
+#endif
+#if CONFIG_DCA_SAMPLER
+static bool _sampled = false;
+#endif /* CONFIG_DCA_SAMPLER */
+
 char *_ps_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
 int _ps_node_getnext_child(db_node_t *node, db_node_t *next_child);
 int _ps_node_getnext(db_node_t *node, db_node_t *next);
 db_node_type_t _ps_node_gettype(const db_node_t *node);
 size_t _ps_node_getsize(const db_node_t *node);
 int32_t _ps_node_getint_value(const db_node_t *node);
-float _ps_node_getfloat_value(const db_node_t *node);
 size_t _ps_node_getstr_value(const db_node_t *node, char *value, size_t bufsize);
-char *_ps_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
+int _ps_node_find_child(const db_node_t *node, const char *name, size_t len,
+                        db_node_t *child);
 
-static db_node_ops_t _db_ps_node_ops = {
+static const db_node_ops_t _db_ps_node_ops = {
     .get_name_fn = _ps_node_getname,
     .get_next_child_fn = _ps_node_getnext_child,
     .get_next_fn = _ps_node_getnext,
@@ -85,34 +101,31 @@ static db_node_ops_t _db_ps_node_ops = {
     .get_size_fn = _ps_node_getsize,
     .get_int_value_fn = _ps_node_getint_value,
     .get_float_value_fn = NULL,
-    .get_str_value_fn = _ps_node_getstr_value};
+    .get_str_value_fn = _ps_node_getstr_value,
+    .find_child_fn = _ps_node_find_child};
 
 /* ps node constructor */
-void _ps_node_init(db_node_t *node, kernel_pid_t pid, uint8_t is_root)
+void _ps_node_init(db_node_t *node, kernel_pid_t pid, uint8_t is_root,
+                   uint8_t field)
 {
-
     node->ops = &_db_ps_node_ops;
     memset(node->private_data.u8, 0, DB_NODE_PRIVATE_DATA_MAX);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
     private_data->pid = pid;
     private_data->is_root = is_root;
+    private_data->field = field;
 }
 
+/* returns the next pid with a thread, KERNEL_PID_LAST + 1 if there is none */
 kernel_pid_t _get_next_pid(kernel_pid_t pid)
 {
-    assert(pid >= KERNEL_PID_FIRST);
-    assert(pid <= KERNEL_PID_LAST + 1);
-    thread_t *p;
+    assert(pid >= KERNEL_PID_UNDEF);
+    assert(pid <= KERNEL_PID_LAST);
     do
     {
         pid += 1;
-        if (pid == KERNEL_PID_LAST + 1)
-        {
-            return KERNEL_PID_LAST + 1;
-        }
-        p = (thread_t *)sched_threads[pid];
-    } while (pid <= KERNEL_PID_LAST && p == NULL);
+    } while (pid <= KERNEL_PID_LAST && sched_threads[pid] == NULL);
     return pid;
 }
 
@@ -120,7 +133,7 @@ void db_new_ps_node(db_node_t *node)
 {
     assert(node);
     assert(sizeof(_db_ps_node_private_data_t) <= DB_NODE_PRIVATE_DATA_MAX);
-    _ps_node_init(node, KERNEL_PID_FIRST, 2u);
+    _ps_node_init(node, _get_next_pid(KERNEL_PID_FIRST - 1), 2u, 0u);
 }
 
 char *_ps_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
@@ -131,7 +144,7 @@ char *_ps_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
         (_db_ps_node_private_data_t *)node->private_data.u8;
     if (private_data->is_root == 2u)
     {
-        strncpy(name, "ps", DB_NODE_NAME_MAX);
+        strncpy(name, db_str(DB_STR(ps)), DB_NODE_NAME_MAX);
     }
     else if (private_data->is_root == 1u)
     {
@@ -141,61 +154,39 @@ char *_ps_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
         DEBUG("subroot name:%s\n", p->name);
         strncpy(name, p->name, DB_NODE_NAME_MAX);
     }
-
-    else if (private_data->is_root == 0u && _field_count < COUNT)
+    else
     {
-        strncpy(name, _ps_node_get_field_name(node, name), DB_NODE_NAME_MAX);
+        assert(private_data->field < COUNT);
+        strncpy(name, field_names[private_data->field], DB_NODE_NAME_MAX);
         DEBUG("field name:%s\n", name);
     }
     return name;
 }
 
 int _ps_node_getnext_child(db_node_t *node, db_node_t *next_child)
-
 {
     assert(node);
     assert(next_child);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
 
-    if (private_data->is_root == 2u)
+    if (private_data->is_root == 2u && private_data->pid <= KERNEL_PID_LAST)
     {
-        if (private_data->pid <= KERNEL_PID_LAST)
-        {
-            _ps_node_init(next_child, private_data->pid, 1u);
-            private_data->pid = _get_next_pid(private_data->pid);
-        }
-        else
-        {
-            /* end of processes list */
-            db_node_set_null(next_child);
-        }
+        /* return child node representing next pid, advance own pid */
+        _ps_node_init(next_child, private_data->pid, 1u, 0u);
+        private_data->pid = _get_next_pid(private_data->pid);
     }
-
-    else if (private_data->is_root == 1u)
+    else if (private_data->is_root == 1u && private_data->field < COUNT)
     {
-        /* return child node representing next pid, advance own pid */
-        if (private_data->pid <= KERNEL_PID_LAST && _field_count < COUNT)
-        {
-            DEBUG("current pid :%d\n", private_data->pid);
-            _ps_node_init(next_child, private_data->pid, 0u);
-            private_data->pid = _get_next_pid(private_data->pid);
-            private_data->is_root = 0u;
-        }
+        /* return next field of the process, advance own field */
+        DEBUG("current pid :%d\n", private_data->pid);
+        _ps_node_init(next_child, private_data->pid, 0u, private_data->field);
+        private_data->field++;
     }
-
     else
     {
-        if (_field_count == COUNT - 1)
-        {
-            /* end of processes list */
-            _field_count = 0;
-            db_node_set_null(next_child);
-        }
-        else
-        {
-            _field_count++;
-        }
+        /* end of processes list, fields or leaf node */
+        db_node_set_null(next_child);
     }
     return 0;
 }
@@ -206,18 +197,12 @@ int _ps_node_getnext(db_node_t *node, db_node_t *next)
     assert(next);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
-    {
-        /* this branch root node has no neighbor */
-        db_node_set_null(next);
-    }
-    else if (private_data->is_root == 1u)
+    if (private_data->is_root == 1u)
     {
-        /* this branch root node has no neighbor */
-        if (private_data->pid <= KERNEL_PID_LAST)
+        kernel_pid_t pid = _get_next_pid(private_data->pid);
+        if (pid <= KERNEL_PID_LAST)
         {
-            kernel_pid_t pid = _get_next_pid(private_data->pid);
-            _ps_node_init(next, pid, 1u);
+            _ps_node_init(next, pid, 1u, 0u);
         }
         else
         {
@@ -225,20 +210,14 @@ int _ps_node_getnext(db_node_t *node, db_node_t *next)
             db_node_set_null(next);
         }
     }
-
+    else if (private_data->is_root == 0u && private_data->field + 1 < COUNT)
+    {
+        _ps_node_init(next, private_data->pid, 0u, private_data->field + 1);
+    }
     else
     {
-        /* retrieve the next child (leaf) node */
-        if (private_data->pid <= KERNEL_PID_LAST)
-        {
-            kernel_pid_t pid = _get_next_pid(private_data->pid);
-            _ps_node_init(next, pid, 0u);
-        }
-        else
-        {
-            /* end of processes list */
-            db_node_set_null(next);
-        }
+        /* branch root has no neighbor, or end of fields */
+        db_node_set_null(next);
     }
     return 0;
 }
@@ -248,40 +227,17 @@ db_node_type_t _ps_node_gettype(const db_node_t *node)
     assert(node);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u) /* root */
+    if (private_data->is_root != 0u) /* root and subroot */
     {
         return db_node_type_inner;
     }
-    else if (private_data->is_root == 1u) /* subroot */
+    else if (private_data->field == STATE)
     {
-
-        return db_node_type_inner;
+        return db_node_type_str;
     }
-    else /* for fields */
+    else /* pid, priority, stack and stack used */
     {
-        switch (_field_count)
-        {
-        case 0:
-            /* for pid */
-            return db_node_type_int;
-            break;
-        case 1:
-            /* for STATE */
-            return db_node_type_str;
-            break;
-        case 2:
-            /* for PRIORITY */
-            return db_node_type_int;
-            break;
-        case 3:
-            /*for STACK */
-            return db_node_type_int;
-            break;
-        default:
-            /*for STACK USED*/
-            return db_node_type_int;
-            break;
-        }
+        return db_node_type_int;
     }
 }
 
@@ -290,19 +246,19 @@ size_t _ps_node_getsize(const db_node_t *node)
     assert(node);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
+    if (private_data->is_root != 0u)
     {
         return 0u;
     }
-    else if (private_data->is_root == 1u)
+    else if (private_data->field == STATE)
     {
-        return 0u;
+        char state[DB_NODE_NAME_MAX];
+        return _ps_node_getstr_value(node, state, sizeof(state));
     }
     else
     {
         return sizeof(int32_t);
     }
-    return 0u;
 }
 
 int32_t _ps_node_getint_value(const db_node_t *node)
@@ -310,85 +266,122 @@ int32_t _ps_node_getint_value(const db_node_t *node)
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
     assert(private_data->pid <= KERNEL_PID_LAST);
-    switch (_field_count)
+    thread_t *p = (thread_t *)sched_threads[private_data->pid];
+    if (p == NULL)
     {
-    case 0:
+        /* thread has exited meanwhile */
+        return -1;
+    }
+    switch (private_data->field)
+    {
+    case PID:
         return (int32_t)private_data->pid;
-        break;
-    case 2:
-        {
-            thread_t *p = (thread_t *)sched_threads[private_data->pid];
-            assert(p != NULL);
-            return p->priority;
-            break;
-        }
-    case 3:
+    case PRIORITY:
+        return p->priority;
+    case STACK:
+        return p->stack_size;
+    case STACK_USED:
+#ifdef PS_CACHE_STACK_USED
+    {
+        db_cache_entry_t *entry = &_stack_used_cache[private_data->pid];
+        uint32_t max_age = CONFIG_DCA_STACK_USED_TTL_MS * US_PER_MS;
+        db_value_t used;
+#if CONFIG_DCA_SAMPLER
+        if (_sampled)
         {
-            thread_t *p = (thread_t *)sched_threads[private_data->pid];
-            assert(p != NULL);
-            return p->stack_size;
-            break;
+            max_age = UINT32_MAX;
         }
-    case 4:
+#endif /* CONFIG_DCA_SAMPLER */
+        if (max_age && db_cache_get(&_stack_used_lock, entry, max_age, &used) == 0)
         {
-            thread_t *p = (thread_t *)sched_threads[private_data->pid];
-            assert(p != NULL);
-            int stacksz = p->stack_size;
-            int stack_free = thread_measure_stack_free(p->stack_start);
-            stacksz -= stack_free;
-            return stacksz;
-            break;
+            return used.i;
         }
+        used.i = p->stack_size - thread_measure_stack_free(p->stack_start);
+        db_cache_put(&_stack_used_lock, entry, used);
+        return used.i;
+    }
+#else
+        return p->stack_size - thread_measure_stack_free(p->stack_start);
+#endif /* PS_CACHE_STACK_USED */
     default:
         return -1;
-        break;
     }
 }
 
 size_t _ps_node_getstr_value(const db_node_t *node, char *value, size_t bufsize)
 {
-    (void)bufsize;
     assert(node);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
 
     assert(private_data->pid <= KERNEL_PID_LAST);
     thread_t *p = (thread_t *)sched_threads[private_data->pid];
-    assert(p != NULL);
+    const char *state = STATE_NAME_UNKNOWN;
 
-    if (_field_count == 1)
+    if (private_data->field != STATE || bufsize == 0)
+    {
+        return 0;
+    }
+    if (p != NULL && p->status < STATUS_NUMOF && state_names[p->status] != NULL)
     {
-        strncpy(value, state_names[p->status], DB_NODE_NAME_MAX);
+        state = state_names[p->status];
     }
-    return 88;
+    strncpy(value, state, bufsize);
+    value[bufsize - 1] = '\0';
+    return strlen(value);
 }
 
-char *_ps_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX])
+int _ps_node_find_child(const db_node_t *node, const char *name, size_t len,
+                        db_node_t *child)
 {
     assert(node);
-    assert(name);
+    assert(child);
     _db_ps_node_private_data_t *private_data =
         (_db_ps_node_private_data_t *)node->private_data.u8;
-    assert(private_data->pid <= KERNEL_PID_LAST);
-    switch (_field_count)
+    if (private_data->is_root == 2u)
     {
-    case 0:
-        strncpy(name, field_names[PID], DB_NODE_NAME_MAX);
-        break;
-    case 1:
-        strncpy(name, field_names[STATE], DB_NODE_NAME_MAX);
-        break;
-    case 2:
-        strncpy(name, field_names[PRIORITY], DB_NODE_NAME_MAX);
-        break;
-    case 3:
-        strncpy(name, field_names[STACK], DB_NODE_NAME_MAX);
-        break;
-    case 4:
-        strncpy(name, field_names[STACK_USED], DB_NODE_NAME_MAX);
-        break;
-    default:
-        break;
+        /* look up the process by its thread name */
+        for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++)
+        {
+            thread_t *p = (thread_t *)sched_threads[pid];
+            if (p != NULL && p->name != NULL &&
+                strncmp(p->name, name, len) == 0 && p->name[len] == '\0')
+            {
+                _ps_node_init(child, pid, 1u, 0u);
+                return 0;
+            }
+        }
     }
-    return name;
-}
\ No newline at end of file
+    else if (private_data->is_root == 1u)
+    {
+        /* look up the field by its name */
+        for (uint8_t field = 0; field < COUNT; field++)
+        {
+            if (strncmp(field_names[field], name, len) == 0 &&
+                field_names[field][len] == '\0')
+            {
+                _ps_node_init(child, private_data->pid, 0u, field);
+                return 0;
+            }
+        }
+    }
+    return -ENOENT;
+}
+
+#if CONFIG_DCA_SAMPLER
+void db_sample_ps(void)
+{
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++)
+    {
+        thread_t *p = (thread_t *)sched_threads[pid];
+        if (p != NULL)
+        {
+            db_value_t used = {
+                .i = p->stack_size - thread_measure_stack_free(p->stack_start)
+            };
+            db_cache_put(&_stack_used_lock, &_stack_used_cache[pid], used);
+        }
+    }
+    _sampled = true;
+}
+#endif /* CONFIG_DCA_SAMPLER */
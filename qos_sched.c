@@ -0,0 +1,473 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/qos_sched.h"
+#include "doriot_dca/latency.h"
+#include "doriot_dca/neighbor_table.h"
+#include "doriot_dca/udp_throughput.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "msg.h"
+#include "mutex.h"
+#include "net/gnrc/ipv6/nib/nc.h"
+#include "net/icmpv6.h"
+#include "net/ipv6/hdr.h"
+#include "net/udp.h"
+#include "random.h"
+#include "thread.h"
+#include "timex.h"
+#include "xtimer.h"
+#include "xfa.h"
+#include "shell.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+#if CONFIG_DCA_QOS_SCHED
+
+/* longest period, so that a jittered period fits into the timeout of
+ * xtimer_msg_receive_timeout() */
+#define QOS_SCHED_PERIOD_MAX (1000U)
+/* payload of the control packets of a throughput test */
+#define QOS_SCHED_CONTROL_SIZE (12U)
+/* traffic of one echo request and its reply with uncompressed headers; a
+ * sweep is charged the fewest requests per neighbor up front and the rest
+ * when it is complete */
+#define QOS_SCHED_PROBE_COST \
+    (2 * (sizeof(ipv6_hdr_t) + sizeof(icmpv6_echo_t) + DEFAULT_DATALEN))
+#define QOS_SCHED_LATENCY_COST (LATENCY_PROBES_LOW * QOS_SCHED_PROBE_COST)
+/* the data packets of a throughput test go both ways */
+#define QOS_SCHED_THROUGHPUT_COST \
+    (2 * UDP_PACKET_COUNT * \
+     (sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t) + UDP_PACKET_SIZE) + \
+     4 * (sizeof(ipv6_hdr_t) + sizeof(udp_hdr_t) + QOS_SCHED_CONTROL_SIZE))
+#define QOS_SCHED_MSG_WAKEUP (0xEF60)
+#define QOS_SCHED_MSG_QUEUE_SIZE (4U)
+
+typedef struct {
+    /* xtimer_now_usec64() when the measurement is due */
+    uint64_t next;
+    /* waiting for the budget, counted once per deferral */
+    bool deferred;
+} _job_t;
+
+static bool _running = false;
+static kernel_pid_t _pid = KERNEL_PID_UNDEF;
+static char _stack[THREAD_STACKSIZE_DEFAULT];
+
+/* protects _config, _stats and the token bucket */
+static mutex_t _lock = MUTEX_INIT;
+static qos_sched_config_t _config = {
+    .latency_period = CONFIG_DCA_QOS_SCHED_LATENCY_PERIOD_S,
+    .throughput_period = CONFIG_DCA_QOS_SCHED_THROUGHPUT_PERIOD_S,
+    .jitter_percent = CONFIG_DCA_QOS_SCHED_JITTER_PERCENT,
+    .budget_bps = CONFIG_DCA_QOS_SCHED_BUDGET_BPS,
+    .burst_bytes = CONFIG_DCA_QOS_SCHED_BURST_BYTES,
+};
+static qos_sched_stats_t _stats;
+static uint64_t _last_refill;
+/* set by qos_sched_set_config(), the thread reschedules its jobs */
+static bool _reconfigured = false;
+
+/* only touched by the scheduler thread */
+static _job_t _latency;
+static _job_t _throughput;
+/* slot of the next neighbor of the throughput round */
+static unsigned _throughput_slot = 0;
+
+/* period in us, varied by +-jitter_percent */
+static uint64_t _jittered(uint32_t period, uint32_t jitter_percent)
+{
+    uint64_t us = (uint64_t)period * US_PER_SEC;
+    uint32_t jitter = (us * jitter_percent) / 100;
+
+    if (jitter == 0) {
+        return us;
+    }
+    return us - jitter + random_uint32_range(0, 2 * jitter + 1);
+}
+
+/* add the tokens earned since the last refill; must hold _lock */
+static void _refill(uint64_t now)
+{
+    if (_config.budget_bps == 0) {
+        _stats.tokens = _config.burst_bytes;
+        _last_refill = now;
+        return;
+    }
+    uint64_t add = ((now - _last_refill) * _config.budget_bps) / US_PER_SEC;
+    if (_stats.tokens + (int64_t)add >= (int64_t)_config.burst_bytes) {
+        _stats.tokens = _config.burst_bytes;
+        _last_refill = now;
+    }
+    else {
+        _stats.tokens += add;
+        /* keep the fraction of a token earned */
+        _last_refill += (add * US_PER_SEC) / _config.budget_bps;
+    }
+}
+
+/* Take cost bytes from the bucket. Returns 0, or the time in us until the
+ * bucket holds enough. */
+static uint32_t _take(uint32_t cost)
+{
+    uint32_t res = 0;
+    int32_t need = (cost < _config.burst_bytes) ? cost : _config.burst_bytes;
+
+    mutex_lock(&_lock);
+    _refill(xtimer_now_usec64());
+    if (_stats.tokens >= need) {
+        _stats.tokens -= cost;
+        _stats.bytes += cost;
+    }
+    else {
+        res = ((uint64_t)(need - _stats.tokens) * US_PER_SEC) /
+              _config.budget_bps + 1;
+    }
+    mutex_unlock(&_lock);
+    return res;
+}
+
+/* Returns 0 if the job may run now and takes its cost from the budget,
+ * otherwise the time in us until it should be checked again. */
+static uint32_t _ready(_job_t *job, uint32_t cost, uint64_t now)
+{
+    if ((int64_t)(job->next - now) > 0) {
+        return job->next - now;
+    }
+    uint32_t wait = _take(cost);
+    if (wait && !job->deferred) {
+        DEBUG("qos_sched: deferring %" PRIu32 " bytes\n", cost);
+        job->deferred = true;
+        mutex_lock(&_lock);
+        _stats.deferred++;
+        mutex_unlock(&_lock);
+    }
+    else if (!wait) {
+        job->deferred = false;
+    }
+    return wait;
+}
+
+static unsigned _num_neighbors(void)
+{
+    void *state = NULL;
+    gnrc_ipv6_nib_nc_t nce;
+    unsigned num = 0;
+
+    while (gnrc_ipv6_nib_nc_iter(0, &state, &nce)) {
+        num++;
+    }
+    return num;
+}
+
+/* Run the latency sweep if it is due. Returns the time until the next
+ * check, 0 if it ran. */
+static uint32_t _run_latency(const qos_sched_config_t *config)
+{
+    uint64_t now = xtimer_now_usec64();
+    uint32_t cost = _num_neighbors() * QOS_SCHED_LATENCY_COST;
+    uint32_t wait = _ready(&_latency, cost, now);
+
+    if (wait) {
+        return wait;
+    }
+    DEBUG("qos_sched: latency sweep\n");
+    int res = db_measure_network_latency();
+    uint32_t used = (res >= 0) ? latency_get_probes() * QOS_SCHED_PROBE_COST
+                               : 0;
+    _latency.next = xtimer_now_usec64() +
+                    _jittered(config->latency_period, config->jitter_percent);
+    mutex_lock(&_lock);
+    _stats.latency_runs++;
+    if (used > cost) {
+        /* neighbors that needed more than the fewest echo requests */
+        _stats.tokens -= used - cost;
+        _stats.bytes += used - cost;
+    }
+    mutex_unlock(&_lock);
+    return 0;
+}
+
+/* Run the throughput test to the next neighbor of the round if it is due.
+ * Returns the time until the next check, 0 if it ran. */
+static uint32_t _run_throughput(const qos_sched_config_t *config)
+{
+    uint64_t now = xtimer_now_usec64();
+    neighbor_entry_t entry;
+    int slot;
+
+    if ((_throughput_slot == 0) && ((int64_t)(_throughput.next - now) <= 0)) {
+        /* a round is due, over the neighbors in the cache now */
+        neighbor_table_sync();
+    }
+    slot = neighbor_table_next(_throughput_slot);
+
+    if (slot < 0) {
+        /* round complete */
+        if (_throughput_slot > 0) {
+            _throughput_slot = 0;
+            _throughput.next = now + _jittered(config->throughput_period,
+                                               config->jitter_percent);
+        }
+        else {
+            /* no neighbors yet */
+            _throughput.next = now + config->throughput_period * US_PER_SEC;
+        }
+        return _throughput.next - now;
+    }
+    uint32_t wait = _ready(&_throughput, QOS_SCHED_THROUGHPUT_COST, now);
+    if (wait) {
+        return wait;
+    }
+    _throughput_slot = slot + 1;
+    if (neighbor_table_get(slot, &entry) == 0) {
+        DEBUG("qos_sched: throughput test to slot %d\n", slot);
+        db_measure_neighbor_throughput(&entry.addr);
+        mutex_lock(&_lock);
+        _stats.throughput_runs++;
+        mutex_unlock(&_lock);
+    }
+    return 0;
+}
+
+/* move the next measurements forward if the new periods are shorter */
+static void _reschedule(const qos_sched_config_t *config)
+{
+    uint64_t now = xtimer_now_usec64();
+    uint64_t next;
+
+    next = now + _jittered(config->latency_period, config->jitter_percent);
+    if ((int64_t)(_latency.next - next) > 0) {
+        _latency.next = next;
+    }
+    next = now + _jittered(config->throughput_period, config->jitter_percent);
+    if ((int64_t)(_throughput.next - next) > 0) {
+        _throughput.next = next;
+    }
+}
+
+static void *_sched_thread(void *arg)
+{
+    (void)arg;
+    msg_t queue[QOS_SCHED_MSG_QUEUE_SIZE];
+    qos_sched_config_t config;
+
+    msg_init_queue(queue, QOS_SCHED_MSG_QUEUE_SIZE);
+    qos_sched_get_config(&config);
+    uint64_t now = xtimer_now_usec64();
+    /* spread the first measurements of nodes booted at the same time */
+    _latency.next = now + random_uint32_range(0,
+        config.latency_period * US_PER_SEC + 1);
+    _throughput.next = now + random_uint32_range(0,
+        config.throughput_period * US_PER_SEC + 1);
+
+    while (1) {
+        uint32_t wait = UINT32_MAX;
+        uint32_t w;
+        msg_t msg;
+
+        qos_sched_get_config(&config);
+        mutex_lock(&_lock);
+        if (_reconfigured) {
+            _reconfigured = false;
+            mutex_unlock(&_lock);
+            _reschedule(&config);
+        }
+        else {
+            mutex_unlock(&_lock);
+        }
+        if (config.latency_period) {
+            if ((w = _run_latency(&config)) == 0) {
+                continue;
+            }
+            wait = (w < wait) ? w : wait;
+        }
+        if (config.throughput_period) {
+            if ((w = _run_throughput(&config)) == 0) {
+                continue;
+            }
+            wait = (w < wait) ? w : wait;
+        }
+        if (wait == UINT32_MAX) {
+            /* nothing to do until the configuration changes */
+            msg_receive(&msg);
+        }
+        else {
+            xtimer_msg_receive_timeout(&msg, wait);
+        }
+    }
+    return NULL;
+}
+
+int db_start_qos_sched(void)
+{
+    if (_running) {
+        return 0;
+    }
+    mutex_lock(&_lock);
+    _last_refill = xtimer_now_usec64();
+    _stats.tokens = _config.burst_bytes;
+    mutex_unlock(&_lock);
+    _pid = thread_create(_stack, sizeof(_stack), THREAD_PRIORITY_MAIN + 1,
+                         THREAD_CREATE_STACKTEST, _sched_thread, NULL,
+                         "dca_qos_sched");
+    if (_pid <= KERNEL_PID_UNDEF) {
+        return -1;
+    }
+    _running = true;
+    return 0;
+}
+
+void qos_sched_get_config(qos_sched_config_t *config)
+{
+    assert(config);
+    mutex_lock(&_lock);
+    *config = _config;
+    mutex_unlock(&_lock);
+}
+
+int qos_sched_set_config(const qos_sched_config_t *config)
+{
+    assert(config);
+    if ((config->jitter_percent > 100) ||
+        (config->latency_period > QOS_SCHED_PERIOD_MAX) ||
+        (config->throughput_period > QOS_SCHED_PERIOD_MAX)) {
+        return -EINVAL;
+    }
+    mutex_lock(&_lock);
+    _refill(xtimer_now_usec64());
+    _config = *config;
+    if (_stats.tokens > (int32_t)_config.burst_bytes) {
+        _stats.tokens = _config.burst_bytes;
+    }
+    _reconfigured = true;
+    mutex_unlock(&_lock);
+    if (_running) {
+        msg_t msg = { .type = QOS_SCHED_MSG_WAKEUP };
+        msg_try_send(&msg, _pid);
+    }
+    return 0;
+}
+
+void qos_sched_get_stats(qos_sched_stats_t *stats)
+{
+    assert(stats);
+    mutex_lock(&_lock);
+    _refill(xtimer_now_usec64());
+    *stats = _stats;
+    mutex_unlock(&_lock);
+}
+
+#ifdef CONFIG_DCA_SHELL
+
+static int _dcasched(int argc, char **argv)
+{
+    qos_sched_config_t config;
+    qos_sched_stats_t stats;
+
+    qos_sched_get_config(&config);
+    if ((argc == 2) && (strcmp(argv[1], "start") == 0)) {
+        return db_start_qos_sched();
+    }
+    if ((argc % 2) == 0) {
+        printf("Usage: %s [start] [<lat|tp|jitter|budget|burst> <value>]...\n"
+               "  lat, tp: period in s (0: off), jitter: %%,\n"
+               "  budget: bytes/s (0: no limit), burst: bytes\n", argv[0]);
+        return 1;
+    }
+    for (int i = 1; i < argc; i += 2) {
+        uint32_t value = scn_u32_dec(argv[i + 1], strlen(argv[i + 1]));
+        if (strcmp(argv[i], "lat") == 0) {
+            config.latency_period = value;
+        }
+        else if (strcmp(argv[i], "tp") == 0) {
+            config.throughput_period = value;
+        }
+        else if (strcmp(argv[i], "jitter") == 0) {
+            config.jitter_percent = value;
+        }
+        else if (strcmp(argv[i], "budget") == 0) {
+            config.budget_bps = value;
+        }
+        else if (strcmp(argv[i], "burst") == 0) {
+            config.burst_bytes = value;
+        }
+        else {
+            printf("unknown setting %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if ((argc > 1) && (qos_sched_set_config(&config) < 0)) {
+        printf("invalid setting, periods are at most %u s\n",
+               QOS_SCHED_PERIOD_MAX);
+        return 1;
+    }
+    qos_sched_get_stats(&stats);
+    printf("%s\n"
+           "latency period: %" PRIu32 " s, runs: %" PRIu32 "\n"
+           "throughput period: %" PRIu32 " s, runs: %" PRIu32 "\n"
+           "jitter: %" PRIu32 " %%\n"
+           "budget: %" PRIu32 " bytes/s, burst: %" PRIu32 " bytes, "
+           "tokens: %" PRId32 "\n"
+           "bytes: %" PRIu32 ", deferred: %" PRIu32 "\n",
+           _running ? "running" : "stopped",
+           config.latency_period, stats.latency_runs,
+           config.throughput_period, stats.throughput_runs,
+           config.jitter_percent,
+           config.budget_bps, config.burst_bytes, stats.tokens,
+           stats.bytes, stats.deferred);
+    return 0;
+}
+
+XFA_USE_CONST(shell_command_t *, shell_commands_xfa);
+
+shell_command_t _dcasched_cmd = { "dcasched", "Configure periodic DCA QoS measurements", _dcasched };
+
+XFA_ADD_PTR(
+    shell_commands_xfa,
+    0,
+    sc_dcasched,
+    &_dcasched_cmd
+    );
+
+#endif /* defined(CONFIG_DCA_SHELL) */
+
+#else /* CONFIG_DCA_QOS_SCHED */
+
+int db_start_qos_sched(void)
+{
+    return -ENOTSUP;
+}
+
+void qos_sched_get_config(qos_sched_config_t *config)
+{
+    assert(config);
+    memset(config, 0, sizeof(*config));
+}
+
+int qos_sched_set_config(const qos_sched_config_t *config)
+{
+    (void)config;
+    return -ENOTSUP;
+}
+
+void qos_sched_get_stats(qos_sched_stats_t *stats)
+{
+    assert(stats);
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif /* CONFIG_DCA_QOS_SCHED */
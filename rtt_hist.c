@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/rtt_hist.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#if CONFIG_DCA_RTT_HIST_BUCKETS < 2
+#error CONFIG_DCA_RTT_HIST_BUCKETS must be at least 2
+#endif
+/* the lower bound of bucket 45 is 2^32 us */
+#if CONFIG_DCA_RTT_HIST_BUCKETS > 44
+#error CONFIG_DCA_RTT_HIST_BUCKETS must be at most 44
+#endif
+
+/* bucket of a round trip time in us */
+static unsigned _bucket(uint32_t rtt)
+{
+    uint32_t units = rtt / RTT_HIST_UNIT_US;
+    unsigned bucket;
+
+    if (units == 0) {
+        return 0;
+    }
+    /* two buckets per power of two, [2^n, 1.5 * 2^n) and [1.5 * 2^n, 2^n+1);
+     * the half is tested on rtt, units has no bit for it below 2 units */
+    unsigned msb = 0;
+    while (units >> (msb + 1)) {
+        msb++;
+    }
+    bucket = 1 + 2 * msb;
+    if (rtt & ((RTT_HIST_UNIT_US << msb) >> 1)) {
+        bucket++;
+    }
+    return (bucket < CONFIG_DCA_RTT_HIST_BUCKETS)
+           ? bucket : CONFIG_DCA_RTT_HIST_BUCKETS - 1;
+}
+
+/* lower bound of a bucket in us */
+static uint32_t _lower(unsigned bucket)
+{
+    if (bucket == 0) {
+        return 0;
+    }
+    uint32_t lower = RTT_HIST_UNIT_US << ((bucket - 1) / 2);
+    return (bucket % 2) ? lower : lower + lower / 2;
+}
+
+void rtt_hist_init(rtt_hist_t *hist)
+{
+    assert(hist);
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT32_MAX;
+}
+
+void rtt_hist_add(rtt_hist_t *hist, uint32_t rtt)
+{
+    assert(hist);
+    unsigned bucket = _bucket(rtt);
+
+    assert((_lower(bucket) <= rtt) &&
+           ((bucket == CONFIG_DCA_RTT_HIST_BUCKETS - 1) ||
+            (rtt < _lower(bucket + 1))));
+
+    if (hist->count[bucket] == UINT16_MAX) {
+        /* age all buckets */
+        for (unsigned i = 0; i < CONFIG_DCA_RTT_HIST_BUCKETS; i++) {
+            hist->count[i] /= 2;
+        }
+    }
+    hist->count[bucket]++;
+    hist->samples++;
+    if (rtt < hist->min) {
+        hist->min = rtt;
+    }
+    if (rtt > hist->max) {
+        hist->max = rtt;
+    }
+}
+
+uint32_t rtt_hist_percentile(const rtt_hist_t *hist, unsigned percent)
+{
+    assert(hist);
+    assert(percent <= 100);
+    uint32_t total = 0;
+    uint32_t sum = 0;
+    unsigned bucket;
+
+    for (bucket = 0; bucket < CONFIG_DCA_RTT_HIST_BUCKETS; bucket++) {
+        total += hist->count[bucket];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    /* rank of the sample, rounded up */
+    uint32_t rank = (total * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (bucket = 0; sum + hist->count[bucket] < rank; bucket++) {
+        sum += hist->count[bucket];
+    }
+    /* interpolate within the bucket, the last one ends at max */
+    uint32_t lower = _lower(bucket);
+    uint32_t upper = (bucket < CONFIG_DCA_RTT_HIST_BUCKETS - 1)
+                     ? _lower(bucket + 1) : hist->max;
+    uint32_t rtt = lower;
+    if (upper > lower) {
+        rtt += ((uint64_t)(upper - lower) * (rank - sum)) / hist->count[bucket];
+    }
+    if (rtt < hist->min) {
+        rtt = hist->min;
+    }
+    if (rtt > hist->max) {
+        rtt = hist->max;
+    }
+    return rtt;
+}
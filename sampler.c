@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/sampler.h"
+#include "doriot_dca/db.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "thread.h"
+#include "xtimer.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+#if CONFIG_DCA_SAMPLER
+
+static bool sampler_running = false;
+static char sampler_stack[THREAD_STACKSIZE_DEFAULT];
+/* bit fl_idx is set once the branch has been sampled */
+static uint8_t _valid = 0;
+static uint32_t _runs = 0;
+static uint32_t _last_us = 0;
+static uint64_t _total_us = 0;
+static uint64_t _start = 0;
+
+static void _sample_branch(uint8_t fl_idx)
+{
+    const db_fl_entry_t *fl_ent = &db_index[fl_idx];
+    db_value_t value;
+
+    for (uint8_t i = 0; i < fl_ent->num_static_entries; i++) {
+        const db_fl_static_entry_t *ent = &fl_ent->static_entries[i];
+        switch (ent->type) {
+        case db_node_type_int:
+            value.i = ((int32_t (*)(void))ent->get_value_fn)();
+            break;
+        case db_node_type_float:
+            value.f = ((float (*)(void))ent->get_value_fn)();
+            break;
+        default:
+            /* strings are constant, they are read directly */
+            continue;
+        }
+        db_fl_shadow_put(fl_idx, i, value);
+    }
+    for (uint8_t i = 0; i < fl_ent->num_dynamic_entries; i++) {
+        if (fl_ent->dynamic_entries[i].sample_fn) {
+            fl_ent->dynamic_entries[i].sample_fn();
+        }
+    }
+    _valid |= (1U << fl_idx);
+}
+
+static void *_sampler_thread(void *args)
+{
+    (void)args;
+    uint32_t next[DB_FL_NUMOF] = { 0 };
+
+    _start = xtimer_now_usec64();
+    while (1) {
+        uint32_t t_start = xtimer_now_usec();
+        uint32_t sleep = UINT32_MAX;
+        uint8_t sampled = 0;
+
+        for (uint8_t fl_idx = 0; fl_idx < DB_FL_NUMOF; fl_idx++) {
+            const db_fl_entry_t *fl_ent = &db_index[fl_idx];
+            if ((fl_ent->shadow == NULL) || (fl_ent->sample_period == 0)) {
+                continue;
+            }
+            uint32_t period = fl_ent->sample_period * US_PER_MS;
+            if ((int32_t)(t_start - next[fl_idx]) >= 0 || !(_valid & (1U << fl_idx))) {
+                _sample_branch(fl_idx);
+                next[fl_idx] = t_start + period;
+                sampled = 1;
+            }
+            uint32_t left = next[fl_idx] - t_start;
+            if (left < sleep) {
+                sleep = left;
+            }
+        }
+        if (sampled) {
+            _last_us = xtimer_now_usec() - t_start;
+            _total_us += _last_us;
+            _runs++;
+            DEBUG("sampler: round %" PRIu32 " took %" PRIu32 " us\n", _runs, _last_us);
+        }
+        if (sleep == UINT32_MAX) {
+            DEBUG("sampler: nothing to sample\n");
+            sampler_running = false;
+            return NULL;
+        }
+        xtimer_usleep(sleep);
+    }
+}
+
+int db_start_sampler(void)
+{
+    assert(DB_FL_NUMOF <= 8);
+    if (sampler_running) {
+        return 0;
+    }
+    if (thread_create(sampler_stack, sizeof(sampler_stack), THREAD_PRIORITY_MAIN + 1,
+                      THREAD_CREATE_STACKTEST, _sampler_thread, NULL,
+                      "dca_sampler") <= KERNEL_PID_UNDEF) {
+        return -1;
+    }
+    sampler_running = true;
+    return 0;
+}
+
+int sampler_read(uint8_t fl_idx, uint8_t sub_idx, db_value_t *value)
+{
+    assert(fl_idx < DB_FL_NUMOF);
+    if (!(_valid & (1U << fl_idx))) {
+        return -ENODATA;
+    }
+    return db_fl_shadow_get(fl_idx, sub_idx, UINT32_MAX, value);
+}
+
+int32_t sampler_get_runs(void)
+{
+    return _runs;
+}
+
+int32_t sampler_get_last_us(void)
+{
+    return _last_us;
+}
+
+float sampler_get_util(void)
+{
+    uint64_t elapsed = xtimer_now_usec64() - _start;
+    if (!sampler_running || elapsed == 0) {
+        return 0.0f;
+    }
+    return (float)_total_us * 100 / elapsed;
+}
+
+#else /* CONFIG_DCA_SAMPLER */
+
+int32_t sampler_get_runs(void)
+{
+    return 0;
+}
+
+int32_t sampler_get_last_us(void)
+{
+    return 0;
+}
+
+float sampler_get_util(void)
+{
+    return 0.0f;
+}
+
+int sampler_read(uint8_t fl_idx, uint8_t sub_idx, db_value_t *value)
+{
+    (void)fl_idx;
+    (void)sub_idx;
+    (void)value;
+    return -ENODATA;
+}
+
+#endif /* CONFIG_DCA_SAMPLER */
@@ -9,7 +9,9 @@
   */
 
 #include "doriot_dca/saul_devices.h"
+#include "doriot_dca/db_fl.h"
 
+#include <errno.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -31,28 +33,30 @@ typedef enum
     COUNT
 } saul_property_t;
 
-static const char *field_names[COUNT] = {
+static const char *const field_names[COUNT] = {
     [CLASS] = "class"};
 #define FIELD_NAME_UNKNOWN "unknown"
 
 typedef struct
 {
-    /* The SAUL registry entry that the node represents */
+    /* root: next device to return; otherwise: the device represented */
     saul_reg_t *dev;
-    /* 1: firstlevel branch root, 0: leaf node */
+    /* 2: firstlevel branch root, 1: device, 0: leaf node */
     uint8_t is_root;
+    /* device: next field to return; leaf: the field represented */
+    uint8_t field;
 } _db_saul_node_private_data_t;
 
-int8_t _saul_field_count = 0;
 char *_saul_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
 int _saul_node_getnext_child(db_node_t *node, db_node_t *next_child);
 int _saul_node_getnext(db_node_t *node, db_node_t *next);
 db_node_type_t _saul_node_gettype(const db_node_t *node);
 size_t _saul_node_getsize(const db_node_t *node);
 size_t _saul_node_getstr_value(const db_node_t *node, char *value, size_t bufsize);
-char *_saul_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX]);
+int _saul_node_find_child(const db_node_t *node, const char *name, size_t len,
+                          db_node_t *child);
 
-static db_node_ops_t _db_saul_node_ops = {
+static const db_node_ops_t _db_saul_node_ops = {
     .get_name_fn = _saul_node_getname,
     .get_next_child_fn = _saul_node_getnext_child,
     .get_next_fn = _saul_node_getnext,
@@ -60,10 +64,12 @@ static db_node_ops_t _db_saul_node_ops = {
     .get_size_fn = _saul_node_getsize,
     .get_int_value_fn = NULL,
     .get_float_value_fn = NULL,
-    .get_str_value_fn = _saul_node_getstr_value};
+    .get_str_value_fn = _saul_node_getstr_value,
+    .find_child_fn = _saul_node_find_child};
 
 /* saul node constructor */
-void _saul_node_init(db_node_t *node, saul_reg_t *dev, uint8_t is_root)
+void _saul_node_init(db_node_t *node, saul_reg_t *dev, uint8_t is_root,
+                     uint8_t field)
 {
     node->ops = &_db_saul_node_ops;
     memset(node->private_data.u8, 0, DB_NODE_PRIVATE_DATA_MAX);
@@ -71,6 +77,7 @@ void _saul_node_init(db_node_t *node, saul_reg_t *dev, uint8_t is_root)
         (_db_saul_node_private_data_t *)node->private_data.u8;
     private_data->dev = dev;
     private_data->is_root = is_root;
+    private_data->field = field;
 }
 
 void db_new_saul_node(db_node_t *node)
@@ -79,7 +86,7 @@ void db_new_saul_node(db_node_t *node)
     assert(sizeof(_db_saul_node_private_data_t) <= DB_NODE_PRIVATE_DATA_MAX);
     /* may be NULL for root */
     saul_reg_t *dev  = saul_reg;
-    _saul_node_init(node, dev, 2u);
+    _saul_node_init(node, dev, 2u, 0u);
 }
 
 char *_saul_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
@@ -90,16 +97,18 @@ char *_saul_node_getname(const db_node_t *node, char name[DB_NODE_NAME_MAX])
         (_db_saul_node_private_data_t *)node->private_data.u8;
     if (private_data->is_root == 2u)
     {
-        strncpy(name, "devices", DB_NODE_NAME_MAX);
+        strncpy(name, db_str(DB_STR(devices)), DB_NODE_NAME_MAX);
     }
     else if (private_data->is_root == 1u)
     {
         assert(private_data->dev != NULL);
-        strcpy(name,private_data->dev->name);
+        strncpy(name, private_data->dev->name, DB_NODE_NAME_MAX);
+        name[DB_NODE_NAME_MAX - 1] = '\0';
     }
-    else if (private_data->is_root == 0u && _saul_field_count < COUNT)
+    else
     {
-        strncpy(name, _saul_node_get_field_name(node, name), DB_NODE_NAME_MAX);
+        assert(private_data->field < COUNT);
+        strncpy(name, field_names[private_data->field], DB_NODE_NAME_MAX);
         DEBUG("field name:%s\n", name);
     }
     return name;
@@ -111,42 +120,22 @@ int _saul_node_getnext_child(db_node_t *node, db_node_t *next_child)
     assert(next_child);
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
+    if (private_data->is_root == 2u && private_data->dev != NULL)
     {
         /* return child node representing saul, advance to next */
-        if (private_data->dev != NULL)
-        {
-            _saul_node_init(next_child, private_data->dev, 1u);
-            private_data->dev = private_data->dev->next;
-        }
-        else
-        {
-            /* end of registry */
-            db_node_set_null(next_child);
-        }
+        _saul_node_init(next_child, private_data->dev, 1u, 0u);
+        private_data->dev = private_data->dev->next;
     }
-    else if (private_data->is_root == 1u)
+    else if (private_data->is_root == 1u && private_data->field < COUNT)
     {
-        /* return child node representing saul, advance to next*/
-        if (private_data->dev != NULL && _saul_field_count < COUNT)
-        {
-            _saul_node_init(next_child, private_data->dev, 0u);
-            private_data->dev = private_data->dev->next;
-            private_data->is_root = 0u;
-        }
+        /* return next field of the device, advance own field */
+        _saul_node_init(next_child, private_data->dev, 0u, private_data->field);
+        private_data->field++;
     }
     else
     {
-        if (_saul_field_count == COUNT - 1)
-        {
-            /* end of saul registry */
-            _saul_field_count = 0;
-            db_node_set_null(next_child);
-        }
-        else
-        {
-            _saul_field_count++;
-        }
+        /* end of saul registry, fields or leaf node */
+        db_node_set_null(next_child);
     }
     return 0;
 }
@@ -157,38 +146,18 @@ int _saul_node_getnext(db_node_t *node, db_node_t *next)
     assert(next);
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
+    if (private_data->is_root == 1u && private_data->dev->next != NULL)
     {
-        /* end of saul registry */
-        db_node_set_null(next);
+        _saul_node_init(next, private_data->dev->next, 1u, 0u);
     }
-    else if (private_data->is_root == 1u)
+    else if (private_data->is_root == 0u && private_data->field + 1 < COUNT)
     {
-        /* return child node representing saul, advance to next*/
-        saul_reg_t *dev = private_data->dev->next;
-        if (private_data->dev != NULL)
-        {
-            _saul_node_init(next, dev, 0u);
-        }
-        else
-        {
-            /* end of saul registry */
-            db_node_set_null(next);
-        }
+        _saul_node_init(next, private_data->dev, 0u, private_data->field + 1);
     }
     else
     {
-        /* retrieve the next child (leaf) node */
-        saul_reg_t *dev= private_data->dev->next;
-        if (private_data->dev != NULL)
-        {
-            _saul_node_init(next, dev, 0u);
-        }
-        else
-        {
-            /* end of saul registry */
-            db_node_set_null(next);
-        }
+        /* branch root has no neighbor, or end of saul registry */
+        db_node_set_null(next);
     }
     return 0;
 }
@@ -198,11 +167,7 @@ db_node_type_t _saul_node_gettype(const db_node_t *node)
     assert(node);
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
-    {
-        return db_node_type_inner;
-    }
-    else if (private_data->is_root == 1u)
+    if (private_data->is_root != 0u)
     {
         return db_node_type_inner;
     }
@@ -217,15 +182,12 @@ size_t _saul_node_getsize(const db_node_t *node)
     assert(node);
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
-    if (private_data->is_root == 2u)
+    if (private_data->is_root != 0u)
     {
         return 0u;
     }
-    else if (private_data->is_root == 1u)
-    {
-        return 0u;
-    }
-    return 0u;
+    char value[DB_NODE_NAME_MAX];
+    return _saul_node_getstr_value(node, value, sizeof(value));
 }
 
 size_t _saul_node_getstr_value(const db_node_t *node, char *value, size_t bufsize)
@@ -233,31 +195,48 @@ size_t _saul_node_getstr_value(const db_node_t *node, char *value, size_t bufsiz
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
     assert(private_data->dev != NULL);
-    (void)bufsize;
-    if (_saul_field_count == 0)
+    if (private_data->field == CLASS && bufsize > 0)
     {
-        strcpy(value,saul_class_to_str(private_data->dev ->driver->type));
+        const char *class = saul_class_to_str(private_data->dev->driver->type);
+        strncpy(value, class ? class : FIELD_NAME_UNKNOWN, bufsize);
+        value[bufsize - 1] = '\0';
         return strlen(value);
     }
-    return 88;
+    return 0;
 }
 
-char *_saul_node_get_field_name(const db_node_t *node, char name[DB_NODE_NAME_MAX])
+int _saul_node_find_child(const db_node_t *node, const char *name, size_t len,
+                          db_node_t *child)
 {
     assert(node);
-    assert(name);
+    assert(child);
     _db_saul_node_private_data_t *private_data =
         (_db_saul_node_private_data_t *)node->private_data.u8;
-    assert(private_data->dev != NULL);
-    switch (_saul_field_count)
+    if (private_data->is_root == 2u)
     {
-    case 0:
-        strncpy(name, field_names[CLASS], DB_NODE_NAME_MAX);
-        break;
-    default:
-        break;
+        /* look up the device by its registry name */
+        for (saul_reg_t *dev = saul_reg; dev != NULL; dev = dev->next)
+        {
+            if (dev->name != NULL &&
+                strncmp(dev->name, name, len) == 0 && dev->name[len] == '\0')
+            {
+                _saul_node_init(child, dev, 1u, 0u);
+                return 0;
+            }
+        }
     }
-    return name;
+    else if (private_data->is_root == 1u)
+    {
+        /* look up the field by its name */
+        for (uint8_t field = 0; field < COUNT; field++)
+        {
+            if (strncmp(field_names[field], name, len) == 0 &&
+                field_names[field][len] == '\0')
+            {
+                _saul_node_init(child, private_data->dev, 0u, field);
+                return 0;
+            }
+        }
+    }
+    return -ENOENT;
 }
-
-
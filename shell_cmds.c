@@ -17,6 +17,8 @@
 #include "stdio_base.h"
 
 #define DCA_SHELL_STRBUF_SIZE 128
+/* number of paths resolved per db_get_many() call */
+#define DCA_SHELL_MGET_BATCH 8
 
 #ifdef CONFIG_DCA_SHELL
 
@@ -74,52 +76,62 @@ static int _dcaq(int argc, char **argv)
     return 0;
 }
 
-static void _print_node_name(db_node_t *node, uint8_t depth) {
-    char name[DB_NODE_NAME_MAX];
-    
-    db_node_get_name(node, name);
-    for (int i = 0; i < depth; i++) {
-        _puts("  ");
+static int _dcamget(int argc, char **argv)
+{
+    if (argc < 2) {
+        _puts("Usage: ");
+        _puts(argv[0]);
+        _puts(" <path>...\nquery several values of the DCA database at once\n");
+        return 1;
     }
-    _puts("- ");
-    _puts(name);
-}
-
-static void _print_node_content(db_node_t *node) {
+    db_result_t results[DCA_SHELL_MGET_BATCH];
     char str[DCA_SHELL_STRBUF_SIZE];
-    db_node_value_to_str(node, str, DCA_SHELL_STRBUF_SIZE);
-    _puts(": ");
-    _puts(str);
+    int ret = 0;
+
+    for (int i = 1; i < argc; i += DCA_SHELL_MGET_BATCH) {
+        size_t num = argc - i;
+        if (num > DCA_SHELL_MGET_BATCH) {
+            num = DCA_SHELL_MGET_BATCH;
+        }
+        db_get_many(NULL, (const char *const *)&argv[i], num, results);
+        for (size_t j = 0; j < num; j++) {
+            _puts(argv[i + j]);
+            _puts(": ");
+            if (db_result_to_str(&results[j], str, sizeof(str)) < 0) {
+                _puts(results[j].res < 0 ? "does not exist" : "no value");
+                ret = 1;
+            }
+            else {
+                _puts(str);
+            }
+            putchar('\n');
+        }
+    }
+    return ret;
 }
 
-static int _tree_r(int8_t depth, uint8_t print_contents, db_node_t *node)
+static int _tree_sink(const db_walk_event_t *ev, void *arg)
 {
-    _print_node_name(node, depth);
-    db_node_type_t type = db_node_get_type(node);
-
-    if (type == db_node_type_int
-        || type == db_node_type_float
-        || type == db_node_type_str) {
-        /* recursion end (file), print contents and return */
-        if (print_contents) {
-            _print_node_content(node);
-        }
-        putchar('\n');
+    uint8_t print_contents = *(uint8_t *)arg;
+
+    if (ev->event == DB_WALK_LEAVE) {
+        return 0;
+    }
+    for (int i = 0; i < ev->depth; i++) {
+        _puts("  ");
     }
-    else if (type == db_node_type_inner) {
-        /* go deeper */
+    _puts("- ");
+    _puts(ev->name);
+    if (ev->event == DB_WALK_ENTER) {
         putchar('/');
-        putchar('\n');
-        db_node_t child;
-        db_node_get_next_child(node, &child);
-        while (!db_node_is_null(&child)) {
-            int r = _tree_r(depth + 1, print_contents, &child);
-            if (r < 0) {
-                return r; /* in case of error */
-            }
-            db_node_get_next_child(node, &child);
-        }
     }
+    else if (print_contents) {
+        char str[DCA_SHELL_STRBUF_SIZE];
+        db_node_value_to_str(ev->node, str, DCA_SHELL_STRBUF_SIZE);
+        _puts(": ");
+        _puts(str);
+    }
+    putchar('\n');
     return 0;
 }
 
@@ -134,7 +146,7 @@ static int _tree(const char *path, uint8_t print_contents)
         _puts(" does not exist\n");
         return 1;
     }
-    return _tree_r(0, print_contents, &node);
+    return db_walk(&node, CONFIG_DCA_PATH_DEPTH_MAX, _tree_sink, &print_contents);
 }
 
 static int _dcadump(int argc, char **argv)
@@ -147,6 +159,7 @@ static int _dcadump(int argc, char **argv)
 XFA_USE_CONST(shell_command_t *, shell_commands_xfa);
 
 shell_command_t _dcaq_cmd = { "dcaq", "Query DCA database", _dcaq };
+shell_command_t _dcamget_cmd = { "dcamget", "Query several DCA values", _dcamget };
 shell_command_t _dcadump_cmd = { "dcadump", "Dump the whole DCA database", _dcadump };
 
 XFA_ADD_PTR(
@@ -156,6 +169,13 @@ XFA_ADD_PTR(
     &_dcaq_cmd
     );
 
+XFA_ADD_PTR(
+    shell_commands_xfa,
+    0,
+    sc_dcamget,
+    &_dcamget_cmd
+    );
+
 XFA_ADD_PTR(
     shell_commands_xfa,
     0,
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2021 Otto-von-Guericke-Universität Magdeburg
+ */
+
+/**
+  * @author  Frank Engelhardt <fengelha@ovgu.de>
+  */
+
+#include "doriot_dca/snapshot.h"
+#include "doriot_dca/db.h"
+#include "doriot_dca/db_fl.h"
+#include "doriot_dca/db_walk.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "atomic_utils.h"
+#include "byteorder.h"
+#include "mutex.h"
+
+#define ENABLE_DEBUG (0)
+#include "debug.h"
+
+/* longest string value in a snapshot */
+#define DB_SNAPSHOT_STR_MAX (128U)
+
+typedef struct {
+    uint8_t *buf;
+    size_t bufsize;
+    /* bytes serialized so far, may exceed bufsize */
+    size_t pos;
+    /* scratch buffer for string values */
+    char str[DB_SNAPSHOT_STR_MAX];
+} _snapshot_t;
+
+static uint32_t _seq = 0;
+
+/* shared buffer for CoAP and VFS, see snapshot.h */
+static mutex_t _buf_lock = MUTEX_INIT;
+static uint8_t _buf[CONFIG_DCA_SNAPSHOT_BUF_SIZE];
+static size_t _buf_len = 0;
+static uint32_t _buf_seq = 0;
+
+static void _put(_snapshot_t *s, const void *data, size_t len)
+{
+    if (s->pos < s->bufsize) {
+        size_t n = s->bufsize - s->pos;
+        memcpy(&s->buf[s->pos], data, (len < n) ? len : n);
+    }
+    s->pos += len;
+}
+
+static void _put_u8(_snapshot_t *s, uint8_t val)
+{
+    _put(s, &val, sizeof(val));
+}
+
+static void _put_u16(_snapshot_t *s, uint16_t val)
+{
+    uint8_t be[sizeof(val)];
+    byteorder_htobebufs(be, val);
+    _put(s, be, sizeof(be));
+}
+
+static void _put_u32(_snapshot_t *s, uint32_t val)
+{
+    uint8_t be[sizeof(val)];
+    byteorder_htobebufl(be, val);
+    _put(s, be, sizeof(be));
+}
+
+/* u8 length and the characters of the string value in s->str */
+static void _put_str(_snapshot_t *s, size_t len)
+{
+    if (len > UINT8_MAX) {
+        len = UINT8_MAX;
+    }
+    _put_u8(s, (uint8_t)len);
+    _put(s, s->str, len);
+}
+
+static int _put_node(const db_walk_event_t *ev, void *arg)
+{
+    _snapshot_t *s = arg;
+
+    if (ev->event == DB_WALK_LEAVE) {
+        /* end of the children */
+        _put_u8(s, db_node_type_null);
+        return 0;
+    }
+    db_str_t ref = db_str_find(ev->name);
+    if (ref != DB_STR_NONE) {
+        _put_u8(s, ev->type | DB_SNAPSHOT_NAME_REF);
+        _put_u16(s, ref);
+    }
+    else {
+        _put_u8(s, ev->type);
+        size_t len = strnlen(ev->name, DB_NODE_NAME_MAX);
+        _put_u8(s, (uint8_t)len);
+        _put(s, ev->name, len);
+    }
+
+    switch (ev->type) {
+    case db_node_type_int:
+        _put_u32(s, (uint32_t)db_node_get_int_value(ev->node));
+        break;
+    case db_node_type_float:
+    {
+        float val = db_node_get_float_value(ev->node);
+        uint32_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        _put_u32(s, bits);
+    }
+    break;
+    case db_node_type_str:
+        _put_str(s, db_node_get_str_value(ev->node, s->str, sizeof(s->str)));
+        break;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static size_t _snapshot(const db_node_t *base, void *buf, size_t bufsize,
+                        uint32_t seq)
+{
+    _snapshot_t s = { .buf = buf, .bufsize = bufsize, .pos = 0 };
+
+    _put_u8(&s, DB_SNAPSHOT_FORMAT);
+    _put_u8(&s, 0);
+    _put_u16(&s, sizeof(db_fl_strtab));
+    _put_u32(&s, seq);
+    db_walk(base, CONFIG_DCA_PATH_DEPTH_MAX, _put_node, &s);
+    DEBUG("db_snapshot: %u bytes, seq %lu\n", (unsigned)s.pos,
+          (unsigned long)seq);
+    return s.pos;
+}
+
+size_t db_snapshot(const db_node_t *base, void *buf, size_t bufsize)
+{
+    assert(buf || (bufsize == 0));
+    return _snapshot(base, buf, bufsize, atomic_fetch_add_u32(&_seq, 1) + 1);
+}
+
+int db_snapshot_take(const db_node_t *base, uint32_t *seq)
+{
+    assert(seq);
+    int res;
+
+    mutex_lock(&_buf_lock);
+    _buf_seq = atomic_fetch_add_u32(&_seq, 1) + 1;
+    _buf_len = _snapshot(base, _buf, sizeof(_buf), _buf_seq);
+    if (_buf_len > sizeof(_buf)) {
+        _buf_len = 0;
+        res = -EFBIG;
+    }
+    else {
+        res = (int)_buf_len;
+    }
+    *seq = _buf_seq;
+    mutex_unlock(&_buf_lock);
+    return res;
+}
+
+ssize_t db_snapshot_read(uint32_t *seq, size_t offset, void *buf,
+                         size_t bufsize)
+{
+    assert(seq);
+    ssize_t res;
+
+    mutex_lock(&_buf_lock);
+    if (_buf_len == 0) {
+        res = -ENODATA;
+    }
+    else if ((*seq != 0) && (*seq != _buf_seq)) {
+        res = -ESTALE;
+    }
+    else {
+        *seq = _buf_seq;
+        if ((offset < _buf_len) && (bufsize > 0)) {
+            size_t n = _buf_len - offset;
+            memcpy(buf, &_buf[offset], (n < bufsize) ? n : bufsize);
+        }
+        res = _buf_len;
+    }
+    mutex_unlock(&_buf_lock);
+    return res;
+}
+
+int db_snapshot_find(const char *path, db_node_t *base)
+{
+    assert(path);
+    assert(base);
+    size_t len = strlen(path);
+    const size_t name_len = sizeof(DB_SNAPSHOT_NAME) - 1;
+
+    if ((len < name_len)
+            || (memcmp(&path[len - name_len], DB_SNAPSHOT_NAME, name_len) != 0)) {
+        return -ENOENT;
+    }
+    len -= name_len;
+    if ((len > 0) && (path[len - 1] != '/')) {
+        /* e.g. "foo.snapshot" */
+        return -ENOENT;
+    }
+    return db_find_node_by_path_len(path, len, base);
+}
@@ -8,16 +8,30 @@
   * @author  Adarsh Raghoothaman <adarsh.raghoothaman@st.ovgu.de>
   */
 
-#include "doriot_dca/linked_list.h"
+#include "doriot_dca/neighbor_table.h"
 #include "doriot_dca/udp_throughput.h"
 
+#include <assert.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "atomic_utils.h"
+#include "byteorder.h"
+#include "fmt.h"
+#include "mutex.h"
 #include "net/sock/udp.h"
 #include "net/ipv6/addr.h"
+#include "net/ipv6/hdr.h"
+#include "net/gnrc.h"
+#include "net/gnrc/ipv6.h"
+#include "net/gnrc/netif/hdr.h"
+#include "net/gnrc/udp.h"
+#include "net/udp.h"
 #include "thread.h"
+#include "utlist.h"
 #include "xtimer.h"
 #include "xfa.h"
 #include "shell.h"
@@ -34,25 +48,653 @@
 #define RESULT 2
 #define TEST_ACK 3
 #define SUCCESS 4
+#define START_TRAIN 5
+#define START_BULK 6
+#define BULK_END 7
+/* reply to a start when all sessions are in use */
+#define BUSY 8
+/* delay probe and its answer, outside of the sessions */
+#define TIME_REQUEST 9
+#define TIME_REPLY 10
+#define CLIENT_PORT (1884U)
 #define PACKET_TIMEOUT 1000000
 #define THROUGHPUT_TIMEOUT 3000000
-#define UDP_PACKET_COUNT 3
-#define UDP_PACKET_SIZE 128
+/* wait for the packet buffer to drain when a bulk test sends too fast */
+#define BULK_BACKOFF_USEC (2000U)
+
+#if (CONFIG_DCA_UDP_TRAIN_LENGTH < 2) || (CONFIG_DCA_UDP_TRAIN_LENGTH > 32)
+#error "CONFIG_DCA_UDP_TRAIN_LENGTH must be between 2 and 32"
+#endif
+
+#if CONFIG_DCA_UDP_TRAIN_SIZE > CONFIG_DCA_UDP_SIZE_MAX
+#error "CONFIG_DCA_UDP_TRAIN_SIZE must be at most CONFIG_DCA_UDP_SIZE_MAX"
+#endif
+
+#if (CONFIG_DCA_UDP_SESSIONS < 1) || (CONFIG_DCA_UDP_SESSIONS > 255)
+#error "CONFIG_DCA_UDP_SESSIONS must be between 1 and 255"
+#endif
+
+#if (CONFIG_DCA_UDP_DELAY_PROBES < 1) || (CONFIG_DCA_UDP_DELAY_PROBES > 32)
+#error "CONFIG_DCA_UDP_DELAY_PROBES must be between 1 and 32"
+#endif
+
+#if CONFIG_DCA_UDP_BULK_SIZE > CONFIG_DCA_UDP_SIZE_MAX
+#error "CONFIG_DCA_UDP_BULK_SIZE must be at most CONFIG_DCA_UDP_SIZE_MAX"
+#endif
 
 static bool server_running = false;
 static sock_udp_t sock;
+static mutex_t client_lock = MUTEX_INIT;
 static sock_udp_t sock_thread;
 static char server_stack[THREAD_STACKSIZE_DEFAULT];
 static msg_t server_msg_queue[SERVER_MSG_QUEUE_SIZE];
-static uint32_t start_timer = 0;
-static uint32_t end_timer = 0;
+/* zeroed payload after the header of the data packets the client sends,
+ * shared by all of them, protected by client_lock */
+static gnrc_pktsnip_t *_pad = NULL;
+/* the same for the data packets the server sends back, server thread only */
+static gnrc_pktsnip_t *_server_pad = NULL;
+/* whether the client socket is open, protected by client_lock */
+static bool _client_ready = false;
+/* number of the last test the client started, protected by client_lock */
+static uint32_t _client_seq = 0;
 
-typedef struct {
+static char _bulk_stack[THREAD_STACKSIZE_DEFAULT];
+/* protects _bulk_running and _bulk_params */
+static mutex_t _bulk_lock = MUTEX_INIT;
+static bool _bulk_running = false;
+static udp_bulk_params_t _bulk_params;
+
+/* Header of the control packets and of the data packets of a train, in
+ * network byte order, so that nodes of any architecture can test each
+ * other. */
+typedef struct __attribute__((packed)) {
     uint8_t id;
+    /* number of data packets; SUCCESS: number of data packets the server
+     * sends back */
     uint8_t packet_count;
-    uint8_t packet_size;
-    uint32_t throughput;
-} _udp_data;
+    /* payload size of the data packets */
+    network_uint16_t packet_size;
+    /* data packets: position in the train or the bulk test; start and
+     * replies: number of the test, chosen by the client */
+    network_uint32_t seq;
+    /* START_TEST: number of data packets the server should send back,
+     * START_BULK: time between two data packets in us, 0 if unpaced,
+     * SUCCESS: throughput, RESULT: bandwidth, in bytes/s; data packets the
+     * server sends back: number of the test; TIME_REQUEST and TIME_REPLY:
+     * xtimer_now_usec() of the client when it sent the probe */
+    network_uint32_t value;
+} _udp_hdr_t;
+
+/* follows the header of the RESULT of a bulk test */
+typedef struct __attribute__((packed)) {
+    network_uint32_t goodput;
+    network_uint32_t received;
+    network_uint32_t reordered;
+    network_uint32_t duplicates;
+} _udp_bulk_report_t;
+
+/* follows the header of a TIME_REPLY, xtimer_now_usec() of the server */
+typedef struct __attribute__((packed)) {
+    /* when the probe arrived */
+    network_uint32_t receive;
+    /* when the reply was sent */
+    network_uint32_t transmit;
+} _udp_time_t;
+
+static_assert(CONFIG_DCA_UDP_TRAIN_SIZE >= sizeof(_udp_hdr_t),
+              "the packets of a train must hold the header");
+
+enum {
+    SESSION_FREE = 0,
+    SESSION_TEST,
+    SESSION_TRAIN,
+    SESSION_BULK,
+    /* the result of a test is out, its data packets are being sent back */
+    SESSION_REVERSE,
+};
+
+/* A test in progress, keyed by the endpoint of the client. Only the server
+ * thread touches the sessions. */
+typedef struct {
+    sock_udp_ep_t remote;
+    uint8_t state;
+    /* data packets announced by a test or a train */
+    uint8_t count;
+    /* payload size of the data packets */
+    uint16_t size;
+    /* data packets a test sends back, at most count */
+    uint8_t reverse;
+    /* data packets sent back so far */
+    uint8_t sent;
+    /* xtimer_now_usec() when the session ends with what has arrived */
+    uint32_t deadline;
+    /* us without a packet after which the session ends */
+    uint32_t idle;
+    /* seq of the start, echoed in the result */
+    network_uint32_t tag;
+    /* data packets that arrived, without duplicates */
+    uint32_t received;
+    /* arrival of the first and of the last data packet */
+    uint32_t first;
+    uint32_t last;
+    union {
+        struct {
+            /* bit seq is set when packet seq arrived */
+            uint32_t mask;
+            uint32_t arrival[CONFIG_DCA_UDP_TRAIN_LENGTH];
+        } train;
+        struct {
+            /* highest sequence number + 1, bit i of window is next - 1 - i */
+            uint32_t next;
+            uint64_t window;
+            uint32_t reordered;
+            uint32_t duplicates;
+        } bulk;
+    };
+} _session_t;
+
+static _session_t _sessions[CONFIG_DCA_UDP_SESSIONS];
+static uint32_t _num_sessions = 0;
+/* starts turned away because all sessions were in use */
+static uint32_t _rejected = 0;
+/* sessions that ended because the client stopped sending */
+static uint32_t _expired = 0;
+/* packets that are malformed or belong to no session */
+static uint32_t _dropped = 0;
+
+/* Send the data packet hdr from port to remote, with a payload of
+ * hdr->packet_size bytes. The packet is built in the packet buffer: only the
+ * header is written, the rest is *pad, which is allocated once for all
+ * packets of its size. Returns 0, or -ENOMEM if the packet buffer is full. */
+static int _send_data(gnrc_pktsnip_t **pad, uint16_t port,
+                      const sock_udp_ep_t *remote, const _udp_hdr_t *data)
+{
+    gnrc_pktsnip_t *pkt, *tmp;
+    size_t len = byteorder_ntohs(data->packet_size) - sizeof(_udp_hdr_t);
+
+    if ((*pad != NULL) && ((*pad)->size != len)) {
+        gnrc_pktbuf_release(*pad);
+        *pad = NULL;
+    }
+    if ((*pad == NULL) && (len > 0)) {
+        *pad = gnrc_pktbuf_add(NULL, NULL, len, GNRC_NETTYPE_UNDEF);
+        if (*pad == NULL) {
+            return -ENOMEM;
+        }
+        memset((*pad)->data, 0, len);
+    }
+    pkt = gnrc_pktbuf_add(NULL, data, sizeof(*data), GNRC_NETTYPE_UNDEF);
+    if (pkt == NULL) {
+        return -ENOMEM;
+    }
+    if (*pad != NULL) {
+        gnrc_pktbuf_hold(*pad, 1);
+        pkt->next = *pad;
+    }
+    if ((tmp = gnrc_udp_hdr_build(pkt, port, remote->port)) == NULL) {
+        goto error;
+    }
+    pkt = tmp;
+    if ((tmp = gnrc_ipv6_hdr_build(pkt, NULL,
+                                   (const ipv6_addr_t *)&remote->addr)) == NULL) {
+        goto error;
+    }
+    pkt = tmp;
+    if (remote->netif != SOCK_ADDR_ANY_NETIF) {
+        if ((tmp = gnrc_netif_hdr_build(NULL, 0, NULL, 0)) == NULL) {
+            goto error;
+        }
+        gnrc_netif_hdr_set_netif(tmp->data,
+                                 gnrc_netif_get_by_pid(remote->netif));
+        LL_PREPEND(pkt, tmp);
+    }
+    if (!gnrc_netapi_dispatch_send(GNRC_NETTYPE_UDP,
+                                   GNRC_NETREG_DEMUX_CTX_ALL, pkt)) {
+        DEBUG("no UDP handler\n");
+        gnrc_pktbuf_release(pkt);
+        return -ENOTCONN;
+    }
+    return 0;
+error:
+    gnrc_pktbuf_release(pkt);
+    return -ENOMEM;
+}
+
+static void _pad_release(gnrc_pktsnip_t **pad)
+{
+    if (*pad != NULL) {
+        /* packets still queued keep their own reference */
+        gnrc_pktbuf_release(*pad);
+        *pad = NULL;
+    }
+}
+
+/* Bytes/s of received packets of size bytes from the first to the last
+ * arrival, the same in both directions of a test and as the goodput of a
+ * bulk test: the first packet starts the clock, so only received - 1
+ * packets count */
+static uint32_t _rate(uint16_t size, uint32_t received, uint32_t first,
+                      uint32_t last)
+{
+    uint32_t elapsed = last - first;
+
+    if ((received < 2) || (elapsed == 0)) {
+        return 0;
+    }
+    return ((uint64_t)size * (received - 1) * US_PER_SEC) / elapsed;
+}
+
+/* Find the session of the client at remote, NULL if it has none */
+static _session_t *_session_find(const sock_udp_ep_t *remote)
+{
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_SESSIONS; i++) {
+        if ((_sessions[i].state != SESSION_FREE) &&
+            sock_udp_ep_equal(&_sessions[i].remote, remote)) {
+            return &_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/* Returns a free session, NULL if all are in use */
+static _session_t *_session_alloc(void)
+{
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_SESSIONS; i++) {
+        if (_sessions[i].state == SESSION_FREE) {
+            return &_sessions[i];
+        }
+    }
+    return NULL;
+}
+
+static void _session_reply(_session_t *session, const void *data, size_t len)
+{
+    sock_udp_send(&sock_thread, data, len, &session->remote);
+}
+
+/* Start the test announced by req for the client at remote, replacing its
+ * session if it has one */
+static void _session_start(_session_t *session, const sock_udp_ep_t *remote,
+                           const _udp_hdr_t *req, uint32_t now)
+{
+    unsigned count = req->packet_count;
+    unsigned size = byteorder_ntohs(req->packet_size);
+    _udp_hdr_t reply = *req;
+    uint8_t state;
+
+    switch (req->id) {
+    case START_TEST:
+        state = (count > 0) ? SESSION_TEST : SESSION_FREE;
+        break;
+    case START_TRAIN:
+        state = ((count >= 2) && (count <= CONFIG_DCA_UDP_TRAIN_LENGTH))
+                ? SESSION_TRAIN : SESSION_FREE;
+        break;
+    default:
+        state = SESSION_BULK;
+        break;
+    }
+    if ((state == SESSION_FREE) || (size < sizeof(_udp_hdr_t)) ||
+        (size > CONFIG_DCA_UDP_SIZE_MAX)) {
+        DEBUG("invalid test %u of %u packets of %u bytes\n", req->id, count,
+              size);
+        atomic_fetch_add_u32(&_dropped, 1);
+        return;
+    }
+    if (session == NULL) {
+        session = _session_alloc();
+        if (session == NULL) {
+            /* tell the client right away instead of letting it time out */
+            reply.id = BUSY;
+            sock_udp_send(&sock_thread, &reply, sizeof(reply), remote);
+            atomic_fetch_add_u32(&_rejected, 1);
+            return;
+        }
+        atomic_fetch_add_u32(&_num_sessions, 1);
+    }
+    /* a client that starts again has given up on its last test */
+    memset(session, 0, sizeof(*session));
+    session->remote = *remote;
+    session->state = state;
+    session->count = count;
+    session->size = size;
+    session->idle = PACKET_TIMEOUT;
+    if (state == SESSION_BULK) {
+        /* a paced test sends a packet every interval */
+        uint32_t interval = byteorder_ntohl(req->value);
+        session->idle += (interval < UDP_BULK_DURATION_MAX_MS * US_PER_MS)
+                         ? interval : UDP_BULK_DURATION_MAX_MS * US_PER_MS;
+    }
+    session->deadline = now + session->idle;
+    session->tag = req->seq;
+    if (state == SESSION_TEST) {
+        uint32_t reverse = byteorder_ntohl(req->value);
+        session->reverse = (reverse < count) ? reverse : count;
+    }
+    DEBUG("session %u: test %u of %u packets of %u bytes\n",
+          (unsigned)(session - _sessions), req->id, count, size);
+    reply.id = TEST_ACK;
+    _session_reply(session, &reply, sizeof(reply));
+}
+
+/* Account for a data packet of the bulk test of session, returns false if
+ * it is a duplicate */
+static bool _bulk_arrived(_session_t *session, uint32_t seq)
+{
+    uint32_t next = session->bulk.next;
+
+    if (seq >= next) {
+        uint32_t shift = seq - next + 1;
+        session->bulk.window = (shift < 64)
+                               ? (session->bulk.window << shift) | 1 : 1;
+        session->bulk.next = seq + 1;
+    }
+    else if (next - 1 - seq >= 64) {
+        /* too late to tell whether it is a duplicate */
+        session->bulk.reordered++;
+    }
+    else if (session->bulk.window & (1ULL << (next - 1 - seq))) {
+        session->bulk.duplicates++;
+        return false;
+    }
+    else {
+        session->bulk.window |= 1ULL << (next - 1 - seq);
+        session->bulk.reordered++;
+    }
+    return true;
+}
+
+/* Handle a data packet or the end of a test, returns true if the test is
+ * complete */
+static bool _session_data(_session_t *session, const _udp_hdr_t *hdr,
+                          uint32_t now)
+{
+    uint32_t seq = byteorder_ntohl(hdr->seq);
+
+    if ((hdr->id == BULK_END) && (session->state == SESSION_BULK)) {
+        return true;
+    }
+    if (hdr->id != DATA_PACKET) {
+        atomic_fetch_add_u32(&_dropped, 1);
+        return false;
+    }
+    switch (session->state) {
+    case SESSION_TRAIN:
+        if ((seq >= session->count) || (session->train.mask & (1UL << seq))) {
+            atomic_fetch_add_u32(&_dropped, 1);
+            return false;
+        }
+        /* the server thread waits in sock_udp_recv() when the packets
+         * arrive, so the time it returns is the arrival time, late by at
+         * most one round of _session_send_back() */
+        session->train.arrival[seq] = now;
+        session->train.mask |= 1UL << seq;
+        return seq == session->count - 1U;
+    case SESSION_BULK:
+        if (!_bulk_arrived(session, seq)) {
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    if (session->received++ == 0) {
+        session->first = now;
+    }
+    session->last = now;
+    return (session->state == SESSION_TEST) &&
+           (session->received >= session->count);
+}
+
+/* Reply the throughput from the first to the last data packet. The data
+ * packets the client asked for are sent back by _session_send_back(). The
+ * server sends no more packets back than arrived, so that a forged start
+ * does not make it flood another node. */
+static void _finish_test(_session_t *session)
+{
+    unsigned reverse = (session->received < session->reverse)
+                       ? session->received : session->reverse;
+    uint32_t throughput = _rate(session->size, session->received,
+                                session->first, session->last);
+    _udp_hdr_t reply = {
+        .id = SUCCESS,
+        .packet_count = reverse,
+        .packet_size = byteorder_htons(session->size),
+        .seq = session->tag,
+        .value = byteorder_htonl(throughput),
+    };
+
+    DEBUG("test: %" PRIu32 " packets in %" PRIu32 " us, throughput %" PRIu32
+          " bytes/sec, %u back\n", session->received,
+          session->last - session->first, throughput, reverse);
+    _session_reply(session, &reply, sizeof(reply));
+    session->reverse = reverse;
+}
+
+/* Reply the bandwidth of the bottleneck link, from the median time between
+ * two packets of the train that arrived one after the other */
+static void _finish_train(_session_t *session)
+{
+    uint32_t gaps[CONFIG_DCA_UDP_TRAIN_LENGTH - 1];
+    unsigned num_gaps = 0;
+    uint32_t dispersion = 0;
+    _udp_hdr_t reply = {
+        .id = RESULT,
+        .packet_count = session->count,
+        .packet_size = byteorder_htons(session->size),
+        .seq = session->tag,
+    };
+
+    for (unsigned seq = 1; seq < session->count; seq++) {
+        if ((session->train.mask & (3UL << (seq - 1))) !=
+            (3UL << (seq - 1))) {
+            continue;
+        }
+        /* insertion sort, trains are short */
+        uint32_t gap = session->train.arrival[seq] -
+                       session->train.arrival[seq - 1];
+        unsigned j = num_gaps++;
+        for (; (j > 0) && (gaps[j - 1] > gap); j--) {
+            gaps[j] = gaps[j - 1];
+        }
+        gaps[j] = gap;
+    }
+    if (num_gaps > 0) {
+        dispersion = gaps[num_gaps / 2];
+    }
+    if (dispersion > 0) {
+        /* the bottleneck link carries the headers as well, counted
+         * uncompressed */
+        uint64_t bytes = session->size + sizeof(udp_hdr_t) +
+                         sizeof(ipv6_hdr_t);
+        reply.value = byteorder_htonl((bytes * US_PER_SEC) / dispersion);
+    }
+    DEBUG("train: %u gaps, dispersion %" PRIu32 " us, bandwidth %" PRIu32
+          " bytes/sec\n", num_gaps, dispersion, byteorder_ntohl(reply.value));
+    _session_reply(session, &reply, sizeof(reply));
+}
+
+/* Report what arrived of a bulk test */
+static void _finish_bulk(_session_t *session)
+{
+    uint8_t out[sizeof(_udp_hdr_t) + sizeof(_udp_bulk_report_t)] = { 0 };
+    _udp_hdr_t *reply = (_udp_hdr_t *)out;
+    _udp_bulk_report_t *report = (_udp_bulk_report_t *)(reply + 1);
+    uint64_t goodput = 0;
+
+    if ((session->received > 1) && (session->last != session->first)) {
+        /* the first packet starts the clock */
+        goodput = ((uint64_t)(session->received - 1) * session->size *
+                   US_PER_SEC) / (session->last - session->first);
+    }
+    DEBUG("bulk: %" PRIu32 " packets, %" PRIu32 " reordered, %" PRIu32
+          " duplicates, goodput %" PRIu32 " bytes/sec\n", session->received,
+          session->bulk.reordered, session->bulk.duplicates,
+          (uint32_t)goodput);
+    reply->id = RESULT;
+    reply->packet_size = byteorder_htons(session->size);
+    reply->seq = session->tag;
+    report->goodput = byteorder_htonl((goodput > UINT32_MAX) ? UINT32_MAX
+                                                             : goodput);
+    report->received = byteorder_htonl(session->received);
+    report->reordered = byteorder_htonl(session->bulk.reordered);
+    report->duplicates = byteorder_htonl(session->bulk.duplicates);
+    _session_reply(session, out, sizeof(out));
+}
+
+static void _session_free(_session_t *session)
+{
+    session->state = SESSION_FREE;
+    atomic_fetch_sub_u32(&_num_sessions, 1);
+}
+
+/* Reply the result of session and free it, or keep it until its data
+ * packets are sent back */
+static void _session_finish(_session_t *session)
+{
+    switch (session->state) {
+    case SESSION_TEST:
+        _finish_test(session);
+        if (session->reverse > 0) {
+            session->state = SESSION_REVERSE;
+            return;
+        }
+        break;
+    case SESSION_TRAIN:
+        _finish_train(session);
+        break;
+    default:
+        _finish_bulk(session);
+        break;
+    }
+    _session_free(session);
+}
+
+/* Send the next data packet back of every session that has some left. The
+ * server thread calls this between two packets it receives, so that the
+ * packets of the other sessions, e.g. of a train, do not wait in the queue
+ * for all the packets of a test to be sent back. */
+static void _session_send_back(void)
+{
+    bool sending = false;
+
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_SESSIONS; i++) {
+        _session_t *session = &_sessions[i];
+        if (session->state != SESSION_REVERSE) {
+            continue;
+        }
+        _udp_hdr_t data = {
+            .id = DATA_PACKET,
+            .packet_size = byteorder_htons(session->size),
+            .seq = byteorder_htonl(session->sent),
+            .value = session->tag,
+        };
+        if (_send_data(&_server_pad, CONFIG_DCA_UDP_SERVER_PORT,
+                       &session->remote, &data) < 0) {
+            DEBUG("could not send packet %u back\n", session->sent);
+            _session_free(session);
+            continue;
+        }
+        if (++session->sent >= session->reverse) {
+            _session_free(session);
+            continue;
+        }
+        sending = true;
+    }
+    if (!sending) {
+        _pad_release(&_server_pad);
+    }
+}
+
+/* Finish the sessions that have not received a packet for their idle time
+ * with what arrived so far. Returns the time until the next session times
+ * out, SOCK_NO_TIMEOUT if there is none, or 0 while data packets are sent
+ * back. */
+static uint32_t _session_expire(uint32_t now)
+{
+    uint32_t timeout = SOCK_NO_TIMEOUT;
+
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_SESSIONS; i++) {
+        _session_t *session = &_sessions[i];
+        if ((session->state == SESSION_FREE) ||
+            (session->state == SESSION_REVERSE)) {
+            continue;
+        }
+        int32_t left = (int32_t)(session->deadline - now);
+        if (left <= 0) {
+            DEBUG("session %u timed out\n", i);
+            atomic_fetch_add_u32(&_expired, 1);
+            _session_finish(session);
+        }
+        else if ((uint32_t)left < timeout) {
+            timeout = left;
+        }
+    }
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_SESSIONS; i++) {
+        if (_sessions[i].state == SESSION_REVERSE) {
+            /* never idle, see _session_send_back() */
+            return 0;
+        }
+    }
+    return timeout;
+}
+
+/* Answer the delay probe req that arrived at now. The server keeps no state
+ * for it, so probes do not take sessions from the tests. */
+static void _time_reply(const sock_udp_ep_t *remote, const _udp_hdr_t *req,
+                        uint32_t now)
+{
+    uint8_t out[sizeof(_udp_hdr_t) + sizeof(_udp_time_t)];
+    _udp_hdr_t *reply = (_udp_hdr_t *)out;
+    _udp_time_t *stamps = (_udp_time_t *)(reply + 1);
+
+    *reply = *req;
+    reply->id = TIME_REPLY;
+    stamps->receive = byteorder_htonl(now);
+    stamps->transmit = byteorder_htonl(xtimer_now_usec());
+    sock_udp_send(&sock_thread, out, sizeof(out), remote);
+}
+
+/* Dispatch the packet of len bytes at data from remote, the payload is only
+ * looked at in the packet buffer */
+static void _server_handle(const sock_udp_ep_t *remote, const void *data,
+                           size_t len, uint32_t now)
+{
+    const _udp_hdr_t *hdr = data;
+    _session_t *session = _session_find(remote);
+
+    if (len < sizeof(*hdr)) {
+        atomic_fetch_add_u32(&_dropped, 1);
+        return;
+    }
+    switch (hdr->id) {
+    case START_TEST:
+    case START_TRAIN:
+    case START_BULK:
+        _session_start(session, remote, hdr, now);
+        return;
+    case TIME_REQUEST:
+        _time_reply(remote, hdr, now);
+        return;
+    default:
+        break;
+    }
+    if (session == NULL) {
+        /* e.g. a data packet of a test that timed out */
+        DEBUG("no session for id %u\n", hdr->id);
+        atomic_fetch_add_u32(&_dropped, 1);
+        return;
+    }
+    if (session->state == SESSION_REVERSE) {
+        /* e.g. a duplicate of the test's data packets */
+        atomic_fetch_add_u32(&_dropped, 1);
+        return;
+    }
+    session->deadline = now + session->idle;
+    if (_session_data(session, hdr, now)) {
+        _session_finish(session);
+    }
+}
 
 void *_udp_server_thread(void *args)
 {
@@ -60,7 +702,6 @@ void *_udp_server_thread(void *args)
     sock_udp_ep_t server = { .port = CONFIG_DCA_UDP_SERVER_PORT, .family = AF_INET6 };
 
     msg_init_queue(server_msg_queue, SERVER_MSG_QUEUE_SIZE);
-    _udp_data *udp_packet = malloc(sizeof(_udp_data));
 
     if (sock_udp_create(&sock_thread, &server, NULL, 0) < 0) {
         DEBUG("Error creating socket\n");
@@ -71,155 +712,720 @@ void *_udp_server_thread(void *args)
     sock_udp_ep_t remote = { .family = AF_INET6 };
 
     while (1) {
+        uint32_t timeout = _session_expire(xtimer_now_usec());
+        void *data, *ctx = NULL;
         int res;
-        if ((res = sock_udp_recv(&sock_thread, udp_packet,
-                                 sizeof(_udp_data), SOCK_NO_TIMEOUT,
-                                 &remote)) < 0) {
-            DEBUG("Error while receiving1\n");
-            continue;
+        /* the second call releases the packet */
+        while ((res = sock_udp_recv_buf(&sock_thread, &data, &ctx, timeout,
+                                        &remote)) > 0) {
+            _server_handle(&remote, data, res, xtimer_now_usec());
         }
-        else if (res == 0) {
-            DEBUG("No data received\n");
+        _session_send_back();
+    }
+}
+
+int32_t udp_server_get_sessions(void)
+{
+    return (int32_t)atomic_load_u32(&_num_sessions);
+}
+
+int32_t udp_server_get_rejected(void)
+{
+    return (int32_t)atomic_load_u32(&_rejected);
+}
+
+int32_t udp_server_get_expired(void)
+{
+    return (int32_t)atomic_load_u32(&_expired);
+}
+
+int32_t udp_server_get_dropped(void)
+{
+    return (int32_t)atomic_load_u32(&_dropped);
+}
+
+enum {
+    CLIENT_IDLE = 0,
+    /* start sent, waiting for the ack */
+    CLIENT_STARTED,
+    CLIENT_ACKED,
+    /* data sent, waiting for the result */
+    CLIENT_SENT,
+    /* result in, waiting for the data packets the server sends back */
+    CLIENT_RECEIVING,
+    CLIENT_DONE,
+    CLIENT_FAILED,
+    /* the server had no session left */
+    CLIENT_BUSY,
+};
+
+/* A test to one neighbor, on the client side */
+typedef struct {
+    sock_udp_ep_t remote;
+    /* start of the test as sent */
+    _udp_hdr_t start;
+    /* xtimer_now_usec() when the server acknowledged the start */
+    uint32_t acked;
+    /* value of the result, and the report of a bulk test */
+    uint32_t value;
+    _udp_bulk_report_t report;
+    /* data packets the server sends back and those that arrived, with the
+     * arrival of the first and of the last one */
+    uint32_t rx_count;
+    uint32_t rx_received;
+    uint32_t rx_first;
+    uint32_t rx_last;
+    /* delay probe: the times of its reply, on the clock of the server, and
+     * xtimer_now_usec() when the reply arrived */
+    uint32_t server_rx;
+    uint32_t server_tx;
+    uint32_t replied;
+    /* result of the delay probes: one-way delays in us and the clock of the
+     * server minus the clock of the client */
+    uint32_t owd_fwd;
+    uint32_t owd_rev;
+    int32_t offset;
+    uint8_t state;
+} _client_test_t;
+
+/* a sweep starts the next test while the last one waits for its result,
+ * protected by client_lock */
+static _client_test_t _tests[2];
+
+/* Take client_lock and create the client socket if there is none yet. The
+ * socket is not bound to a server, it stays open for the tests to all
+ * neighbors on all interfaces. Returns 0, or a negative errno without
+ * client_lock. */
+static int _client_lock(void)
+{
+    sock_udp_ep_t local = { .port = CLIENT_PORT, .family = AF_INET6 };
+    int res;
+
+    /* the client socket and port are shared by the shell and the scheduler */
+    mutex_lock(&client_lock);
+    if (!_client_ready) {
+        if ((res = sock_udp_create(&sock, &local, NULL, 0)) < 0) {
+            DEBUG("Error creating socket\n");
+            mutex_unlock(&client_lock);
+            return res;
+        }
+        _client_ready = true;
+    }
+    return 0;
+}
+
+static void _client_unlock(void)
+{
+    _pad_release(&_pad);
+    mutex_unlock(&client_lock);
+}
+
+/* Set up test to the server of addr, reached via iface, 0: the first
+ * interface if addr is link local */
+static void _client_prepare(_client_test_t *test, const ipv6_addr_t *addr,
+                            unsigned iface, uint8_t id, uint8_t count,
+                            uint16_t size)
+{
+    memset(test, 0, sizeof(*test));
+    test->remote.family = AF_INET6;
+    memcpy(&test->remote.addr, addr, sizeof(*addr));
+    if ((iface == 0) && ipv6_addr_is_link_local(addr)) {
+        gnrc_netif_t *netif = gnrc_netif_iter(NULL);
+        iface = netif->pid;
+    }
+    test->remote.netif = iface;
+    test->remote.port = CONFIG_DCA_UDP_SERVER_PORT;
+    test->start.id = id;
+    test->start.packet_count = count;
+    test->start.packet_size = byteorder_htons(size);
+    if (id == START_TEST) {
+        /* as many back as there, to compare both directions */
+        test->start.value = byteorder_htonl(count);
+    }
+}
+
+/* Send the start of test, with a new number to tell its replies apart from
+ * those to earlier tests */
+static void _client_start(_client_test_t *test)
+{
+    test->start.seq = byteorder_htonl(++_client_seq);
+    test->state = (sock_udp_send(&sock, &test->start, sizeof(test->start),
+                                 &test->remote) < 0) ? CLIENT_FAILED
+                                                     : CLIENT_STARTED;
+}
+
+/* Account for a data packet the server sent back for test */
+static void _client_data(_client_test_t *test, uint32_t now)
+{
+    if (test->rx_received++ == 0) {
+        test->rx_first = now;
+    }
+    test->rx_last = now;
+    if ((test->state == CLIENT_RECEIVING) &&
+        (test->rx_received >= test->rx_count)) {
+        test->state = CLIENT_DONE;
+    }
+}
+
+/* Pass the packet of len bytes at data from remote to its test */
+static void _client_handle(const sock_udp_ep_t *remote, const void *data,
+                           size_t len, uint32_t now)
+{
+    const _udp_hdr_t *hdr = data;
+
+    if (len < sizeof(*hdr)) {
+        return;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(_tests); i++) {
+        _client_test_t *test = &_tests[i];
+        if ((remote->port != test->remote.port) ||
+            !ipv6_addr_equal((ipv6_addr_t *)&remote->addr,
+                             (ipv6_addr_t *)&test->remote.addr)) {
             continue;
         }
-        else if (res > 0) {
-            if (udp_packet->id == START_TEST) {
-                DEBUG("packet count:%d\n", udp_packet->packet_count);
-                DEBUG("packet size:%d\n", udp_packet->packet_size);
-                DEBUG("Client Connected\n");
-                char buf[udp_packet->packet_size];
-                udp_packet->id = TEST_ACK;
-                sock_udp_send(&sock_thread, udp_packet,
-                              sizeof(_udp_data),
-                              &remote);
-                int i = 0;
-                for (i = 0; i < udp_packet->packet_count; i++) {
-                    if ((res = sock_udp_recv(&sock_thread, buf,
-                                             sizeof(buf), PACKET_TIMEOUT,
-                                             &remote)) < 0) {
-                        DEBUG("Error while receiving: %d\n", res);
-                        break;
-                    }
-                    else {
-                        if (i == 0) {
-                            start_timer = xtimer_now_usec();
-                        }
-                    }
-                }
-                end_timer = xtimer_now_usec() - 100;
-                if (i < udp_packet->packet_count) {
-                    end_timer -= PACKET_TIMEOUT;
-                }
-                udp_packet->throughput = (udp_packet->packet_size * i * US_PER_SEC) /
-                                         (end_timer - start_timer);
-                DEBUG("Receieved %d packets\n", i);
-                DEBUG("total bytes received:%d\n", (udp_packet->packet_size * i));
-                DEBUG("time diff: %" PRIu32 " uS\n", (end_timer - start_timer));
-                DEBUG("throughput: %" PRIu32 " bytes/sec\n", udp_packet->throughput);
-                xtimer_usleep(100000);
-                udp_packet->id = SUCCESS;
-                sock_udp_send(&sock_thread, udp_packet,
-                              sizeof(_udp_data),
-                              &remote);
-            }
-            else {
-                DEBUG("ID error: %d", udp_packet->id);
-                return NULL;
+        if (hdr->id == DATA_PACKET) {
+            /* may overtake a lost or late result */
+            if ((hdr->value.u32 == test->start.seq.u32) &&
+                ((test->state == CLIENT_SENT) ||
+                 (test->state == CLIENT_RECEIVING))) {
+                _client_data(test, now);
+                break;
             }
+            continue;
+        }
+        if (hdr->seq.u32 != test->start.seq.u32) {
+            continue;
+        }
+        if ((test->state == CLIENT_STARTED) && (hdr->id == TEST_ACK)) {
+            test->acked = now;
+            test->state = CLIENT_ACKED;
         }
-        else {
-            DEBUG("Received %d", res);
-            DEBUG("id :%d\n", udp_packet->id);
+        else if ((test->state == CLIENT_STARTED) && (hdr->id == BUSY)) {
+            test->state = CLIENT_BUSY;
         }
+        else if ((test->state == CLIENT_STARTED) && (hdr->id == TIME_REPLY) &&
+                 (len >= sizeof(*hdr) + sizeof(_udp_time_t))) {
+            const _udp_time_t *stamps = (const _udp_time_t *)(hdr + 1);
+            test->server_rx = byteorder_ntohl(stamps->receive);
+            test->server_tx = byteorder_ntohl(stamps->transmit);
+            test->replied = now;
+            test->state = CLIENT_DONE;
+        }
+        else if ((test->state == CLIENT_SENT) && (hdr->id == SUCCESS)) {
+            test->value = byteorder_ntohl(hdr->value);
+            test->rx_count = hdr->packet_count;
+            test->state = (test->rx_received >= test->rx_count)
+                          ? CLIENT_DONE : CLIENT_RECEIVING;
+        }
+        else if ((test->state == CLIENT_SENT) && (hdr->id == RESULT)) {
+            test->value = byteorder_ntohl(hdr->value);
+            if (len >= sizeof(*hdr) + sizeof(test->report)) {
+                memcpy(&test->report, hdr + 1, sizeof(test->report));
+            }
+            test->state = CLIENT_DONE;
+        }
+        break;
     }
 }
 
-int db_measure_network_throughput(void)
+/* Receive packets within timeout us and pass them to their tests. The data
+ * packets the server sends back are only looked at in the packet buffer.
+ * Returns 0 or a negative errno. */
+static int _client_poll(uint32_t timeout)
 {
+    sock_udp_ep_t remote;
+    void *data, *ctx = NULL;
     int res;
-    int i = 0;
-    sock_udp_ep_t remote = { .family = AF_INET6 };
-    char addr_str[IPV6_ADDR_MAX_STR_LEN];
-    unsigned iface = 0;
+
+    /* the second call releases the packet */
+    while ((res = sock_udp_recv_buf(&sock, &data, &ctx, timeout,
+                                    &remote)) > 0) {
+        _client_handle(&remote, data, res, xtimer_now_usec());
+    }
+    return res;
+}
+
+/* Wait up to timeout us for test to move on from state, returns false if
+ * it did not or failed */
+static bool _client_wait(_client_test_t *test, uint8_t state, uint32_t timeout)
+{
+    uint32_t start = xtimer_now_usec();
+
+    while (test->state == state) {
+        uint32_t elapsed = xtimer_now_usec() - start;
+        if ((elapsed >= timeout) ||
+            (_client_poll(timeout - elapsed) == -ETIMEDOUT)) {
+            test->state = CLIENT_FAILED;
+        }
+    }
+    return (test->state != CLIENT_FAILED) && (test->state != CLIENT_BUSY);
+}
+
+/* Wait for the server to acknowledge test, which _client_start() started */
+static bool _client_acked(_client_test_t *test)
+{
+    if (!_client_wait(test, CLIENT_STARTED, PACKET_TIMEOUT)) {
+        return false;
+    }
+    if (xtimer_now_usec() - test->acked > PACKET_TIMEOUT / 2) {
+        /* started early by a sweep; the server may give up on it before
+         * the data is in */
+        _client_start(test);
+        return _client_wait(test, CLIENT_STARTED, PACKET_TIMEOUT);
+    }
+    return true;
+}
+
+/* Send CONFIG_DCA_UDP_DELAY_PROBES delay probes to the server of test, one
+ * after the other, and estimate the one-way delays from their timestamps.
+ * The differences of the timestamps are taken modulo 2^32, so the clocks of
+ * the nodes may be any time apart. A server that does not answer the first
+ * two probes is not probed further. */
+static void _client_delay(_client_test_t *test)
+{
+    uint32_t fwd[CONFIG_DCA_UDP_DELAY_PROBES];
+    uint32_t rev[CONFIG_DCA_UDP_DELAY_PROBES];
+    uint32_t best = UINT32_MAX;
+    uint32_t offset = 0;
+    unsigned replies = 0;
+
+    for (unsigned i = 0; i < CONFIG_DCA_UDP_DELAY_PROBES; i++) {
+        if ((i == 2) && (replies == 0)) {
+            break;
+        }
+        uint32_t sent = xtimer_now_usec();
+        test->start.value = byteorder_htonl(sent);
+        _client_start(test);
+        if (!_client_wait(test, CLIENT_STARTED, PACKET_TIMEOUT)) {
+            DEBUG("delay: probe %u lost\n", i);
+            continue;
+        }
+        /* round trip time without the time the server held the probe */
+        int32_t rtt = (int32_t)((test->replied - sent) -
+                                (test->server_tx - test->server_rx));
+        fwd[replies] = test->server_rx - sent;
+        rev[replies] = test->replied - test->server_tx;
+        if (rtt < 0) {
+            rtt = 0;
+        }
+        /* the probe with the least round trip time queued the least, its
+         * offset is the best guess, as in NTP */
+        if ((uint32_t)rtt < best) {
+            best = rtt;
+            offset = fwd[replies] - best / 2;
+        }
+        replies++;
+    }
+    if (replies == 0) {
+        test->state = CLIENT_FAILED;
+        return;
+    }
+    test->owd_fwd = UINT32_MAX;
+    test->owd_rev = UINT32_MAX;
+    for (unsigned i = 0; i < replies; i++) {
+        /* the least delay of each direction, the rest is queueing */
+        int32_t f = (int32_t)(fwd[i] - offset);
+        int32_t r = (int32_t)(rev[i] + offset);
+        f = (f > 0) ? f : 0;
+        r = (r > 0) ? r : 0;
+        if ((uint32_t)f < test->owd_fwd) {
+            test->owd_fwd = f;
+        }
+        if ((uint32_t)r < test->owd_rev) {
+            test->owd_rev = r;
+        }
+    }
+    test->offset = (int32_t)offset;
+    test->state = CLIENT_DONE;
+}
+
+/* Run a throughput test or a train up to its result and the data packets
+ * the server sends back. The start of next is sent while the server works
+ * out the result, so that a sweep does not wait for two round trips between
+ * the tests. */
+static void _client_run(_client_test_t *test, _client_test_t *next)
+{
+    _udp_hdr_t data = {
+        .id = DATA_PACKET,
+        .packet_size = test->start.packet_size,
+    };
+
+    if (test->start.id == TIME_REQUEST) {
+        _client_delay(test);
+        return;
+    }
+    if (test->state == CLIENT_IDLE) {
+        _client_start(test);
+    }
+    if (!_client_acked(test)) {
+        DEBUG("no ack\n");
+        return;
+    }
+    for (unsigned seq = 0; seq < test->start.packet_count; seq++) {
+        /* back to back, the bottleneck link spaces them out */
+        data.seq = byteorder_htonl(seq);
+        if (_send_data(&_pad, CLIENT_PORT, &test->remote, &data) < 0) {
+            DEBUG("could not send packet %u\n", seq);
+            test->state = CLIENT_FAILED;
+            return;
+        }
+    }
+    test->state = CLIENT_SENT;
+    if (next != NULL) {
+        _client_start(next);
+    }
+    if (_client_wait(test, CLIENT_SENT, THROUGHPUT_TIMEOUT) &&
+        !_client_wait(test, CLIENT_RECEIVING, PACKET_TIMEOUT)) {
+        /* the result is in, keep what arrived of the packets sent back */
+        test->state = CLIENT_DONE;
+    }
+}
+
+/* Store the result of test in the neighbor table, 0 if it failed */
+static void _client_store(const _client_test_t *test)
+{
+    const ipv6_addr_t *addr = (const ipv6_addr_t *)&test->remote.addr;
+    uint32_t value = (test->state == CLIENT_DONE) ? test->value : 0;
+
+    if (test->start.id == START_TRAIN) {
+        DEBUG("train: bandwidth %" PRIu32 " bytes/sec\n", value);
+        neighbor_table_update_bandwidth(addr, value);
+    }
+    else if (test->start.id == TIME_REQUEST) {
+        /* keep the last delays if no probe came back */
+        if (test->state == CLIENT_DONE) {
+            DEBUG("delay: %" PRIu32 " us forward, %" PRIu32 " us reverse, "
+                  "clock offset %" PRId32 " us\n", test->owd_fwd,
+                  test->owd_rev, test->offset);
+            neighbor_table_update_delay(addr, test->owd_fwd, test->owd_rev,
+                                        test->offset);
+        }
+    }
+    else {
+        uint32_t rx = 0;
+        if (test->state == CLIENT_DONE) {
+            rx = _rate(byteorder_ntohs(test->start.packet_size),
+                       test->rx_received, test->rx_first, test->rx_last);
+        }
+        DEBUG("throughput: %" PRIu32 " bytes/sec to, %" PRIu32
+              " bytes/sec from the neighbor\n", value, rx);
+        neighbor_table_update_throughput(addr, value, rx);
+    }
+}
+
+static int _client_single(const ipv6_addr_t *addr, uint8_t id,
+                          uint8_t count, uint16_t size)
+{
+    if (_client_lock() < 0) {
+        return 1;
+    }
+    _client_prepare(&_tests[0], addr, 0, id, count, size);
+    _client_run(&_tests[0], NULL);
+    _client_store(&_tests[0]);
+    _client_unlock();
+    return 0;
+}
+
+/* Run a test of id to each neighbor, the next one a guard time after the
+ * result of the last one */
+static int _client_sweep(uint8_t id, uint8_t count, uint16_t size)
+{
     void *state = NULL;
     gnrc_ipv6_nib_nc_t nce;
+    _client_test_t *test = &_tests[0];
+    _client_test_t *next = &_tests[1];
+    bool more;
 
-    while (gnrc_ipv6_nib_nc_iter(iface, &state, &nce)) {
-        struct neighbor_entryl *node = malloc(sizeof(struct neighbor_entryl));
-        node->addr = nce.ipv6;
-        node->latency = 0;
-        node->packet_loss = 0;
-        node->throughput = 0;
-        node->next = NULL;
-        ipv6_addr_to_str(addr_str, &(nce.ipv6), sizeof(addr_str));
-        if (ipv6_addr_from_str((ipv6_addr_t *)&remote.addr, addr_str) == NULL) {
-            DEBUG("Error: unable to parse destination address\n");
-            return 1;
+    neighbor_table_sync();
+    more = gnrc_ipv6_nib_nc_iter(0, &state, &nce);
+    if (!more) {
+        return 0;
+    }
+    if (_client_lock() < 0) {
+        return 1;
+    }
+    _client_prepare(test, &nce.ipv6, gnrc_ipv6_nib_nc_get_iface(&nce), id,
+                    count, size);
+    while (1) {
+        more = gnrc_ipv6_nib_nc_iter(0, &state, &nce);
+        if (more) {
+            _client_prepare(next, &nce.ipv6, gnrc_ipv6_nib_nc_get_iface(&nce),
+                            id, count, size);
         }
-        if (ipv6_addr_is_link_local((ipv6_addr_t *)&remote.addr)) {
-            /* choose first interface when address is link local */
-            gnrc_netif_t *netif = gnrc_netif_iter(NULL);
-            remote.netif = (uint16_t)netif->pid;
+        _client_run(test, more ? next : NULL);
+        _client_store(test);
+        if (!more) {
+            break;
         }
-        remote.port = CONFIG_DCA_UDP_SERVER_PORT;
-        sock_udp_ep_t client = { .port = 1884, .family = AF_INET6 };
-        if (sock_udp_create(&sock, &client, &remote, 0) < 0) {
-            DEBUG("Error creating socket\n");
-            return 1;
+        _client_test_t *tmp = test;
+        test = next;
+        next = tmp;
+        xtimer_usleep(CONFIG_DCA_UDP_GUARD_MS * US_PER_MS);
+    }
+    _client_unlock();
+    return 0;
+}
+
+int db_measure_neighbor_throughput(const ipv6_addr_t *addr)
+{
+    return _client_single(addr, START_TEST, UDP_PACKET_COUNT,
+                          UDP_PACKET_SIZE);
+}
+
+int db_measure_network_throughput(void)
+{
+    return _client_sweep(START_TEST, UDP_PACKET_COUNT, UDP_PACKET_SIZE);
+}
+
+int db_measure_neighbor_bandwidth(const ipv6_addr_t *addr)
+{
+    return _client_single(addr, START_TRAIN, CONFIG_DCA_UDP_TRAIN_LENGTH,
+                          CONFIG_DCA_UDP_TRAIN_SIZE);
+}
+
+int db_measure_network_bandwidth(void)
+{
+    return _client_sweep(START_TRAIN, CONFIG_DCA_UDP_TRAIN_LENGTH,
+                         CONFIG_DCA_UDP_TRAIN_SIZE);
+}
+
+int db_measure_neighbor_delay(const ipv6_addr_t *addr)
+{
+    return _client_single(addr, TIME_REQUEST, 0, sizeof(_udp_hdr_t));
+}
+
+int db_measure_network_delay(void)
+{
+    return _client_sweep(TIME_REQUEST, 0, sizeof(_udp_hdr_t));
+}
+
+void udp_bulk_params_init(udp_bulk_params_t *params)
+{
+    assert(params);
+    params->duration_ms = CONFIG_DCA_UDP_BULK_DURATION_MS;
+    params->bytes = 0;
+    params->size = CONFIG_DCA_UDP_BULK_SIZE;
+    params->rate = 0;
+}
+
+int udp_bulk_params_set(udp_bulk_params_t *params, const char *name,
+                        const char *value)
+{
+    assert(params && name && value);
+    size_t len = strlen(value);
+
+    /* up to 999999999, scn_u32_dec() does not check for overflows */
+    if ((len == 0) || (len > 9) || !fmt_is_number(value)) {
+        return -EINVAL;
+    }
+    uint32_t num = scn_u32_dec(value, len);
+    if (strcmp(name, "time") == 0) {
+        if (num > UDP_BULK_DURATION_MAX_MS) {
+            return -EINVAL;
         }
-        _udp_data *udp_packet = malloc(sizeof(_udp_data));
-        udp_packet->id = START_TEST;
-        udp_packet->packet_count = UDP_PACKET_COUNT;
-        udp_packet->packet_size = UDP_PACKET_SIZE;
-        udp_packet->throughput = 0;
-        char payload[UDP_PACKET_SIZE];
-        if ((res = sock_udp_send(&sock, udp_packet, sizeof(udp_packet), &remote)) < 0) {
-            DEBUG("could not send start_test packet");
-            goto finish;
-        }
-        if ((res = sock_udp_recv(&sock, udp_packet,
-                                 sizeof(_udp_data), PACKET_TIMEOUT,
-                                 &remote)) < 0) {
-            DEBUG("Error while receiving test ack");
-            goto finish;
-        }
-        if (udp_packet->id == TEST_ACK) {
-            for (i = 0; i < udp_packet->packet_count; i++) {
-                if ((res = sock_udp_send(&sock, payload, sizeof(payload), &remote)) < 0) {
-                    DEBUG("could not send udp payloads");
-                    goto finish;
-                }
-                if (i == 0) {
-                    xtimer_usleep(100);
-                }
-            }
-            if ((res = sock_udp_recv(&sock, udp_packet,
-                                     sizeof(_udp_data), THROUGHPUT_TIMEOUT,
-                                     &remote)) < 0) {
-                DEBUG("error receiving result\n");
-                goto finish;
-            }
-            if (udp_packet->id == SUCCESS) {
-                DEBUG("%s/ \n\tthroughput :%" PRIu32 " bytes/sec\n", addr_str,
-                       udp_packet->throughput);
-                node->throughput = udp_packet->throughput;
-            }
+        params->duration_ms = num;
+    }
+    else if (strcmp(name, "bytes") == 0) {
+        params->bytes = num;
+    }
+    else if (strcmp(name, "size") == 0) {
+        if ((num < sizeof(_udp_hdr_t)) || (num > CONFIG_DCA_UDP_SIZE_MAX)) {
+            return -EINVAL;
+        }
+        params->size = num;
+    }
+    else if (strcmp(name, "rate") == 0) {
+        params->rate = num;
+    }
+    else {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* whether sock_udp_send() failed because the packet buffer is full */
+static inline bool _is_full(int res)
+{
+    return (res == -ENOMEM) || (res == -ENOBUFS) || (res == -EAGAIN);
+}
+
+/* us between two data packets of a bulk test, 0 if it is not paced */
+static uint32_t _bulk_interval(const udp_bulk_params_t *params)
+{
+    if (params->rate == 0) {
+        return 0;
+    }
+    uint64_t interval = ((uint64_t)params->size * US_PER_SEC) / params->rate;
+    return (interval > UINT32_MAX) ? UINT32_MAX : interval;
+}
+
+/* send data packets until the test is over, returns the number sent or a
+ * negative errno */
+static int32_t _bulk_send(const udp_bulk_params_t *params,
+                          sock_udp_ep_t *remote)
+{
+    uint32_t start = xtimer_now_usec();
+    xtimer_ticks32_t wake = xtimer_now();
+    uint32_t interval = _bulk_interval(params);
+    uint32_t seq = 0;
+    uint64_t bytes = 0;
+    _udp_hdr_t data = {
+        .id = DATA_PACKET,
+        .packet_size = byteorder_htons(params->size),
+    };
+
+    while (((params->duration_ms == 0) ||
+            (xtimer_now_usec() - start < params->duration_ms * US_PER_MS)) &&
+           ((params->bytes == 0) || (bytes < params->bytes))) {
+        data.seq = byteorder_htonl(seq);
+        int res = _send_data(&_pad, CLIENT_PORT, remote, &data);
+        if (_is_full(res)) {
+            /* faster than the link, the packet was not sent */
+            xtimer_usleep(BULK_BACKOFF_USEC);
+            continue;
         }
+        if (res < 0) {
+            DEBUG("bulk: could not send packet %" PRIu32 ": %d\n", seq, res);
+            return res;
+        }
+        seq++;
+        bytes += params->size;
+        if (interval != 0) {
+            xtimer_periodic_wakeup(&wake, interval);
+        }
+    }
+    return seq;
+}
+
+/* Run a bulk test to addr via iface, see _client_prepare() */
+static int _bulk_neighbor(const ipv6_addr_t *addr, unsigned iface,
+                          const udp_bulk_params_t *params,
+                          udp_bulk_result_t *result)
+{
+    _client_test_t *test = &_tests[0];
+    _udp_hdr_t end = { .id = BULK_END };
+    int res;
+
+    memset(result, 0, sizeof(*result));
+    if ((params->size < sizeof(_udp_hdr_t)) ||
+        (params->size > CONFIG_DCA_UDP_SIZE_MAX) ||
+        (params->duration_ms > UDP_BULK_DURATION_MAX_MS) ||
+        ((params->duration_ms == 0) && (params->bytes == 0))) {
+        return -EINVAL;
+    }
+    if (_client_lock() < 0) {
+        return -ENOTCONN;
+    }
+    _client_prepare(test, addr, iface, START_BULK, 0, params->size);
+    /* so that the server waits for the packets of a slow test */
+    test->start.value = byteorder_htonl(_bulk_interval(params));
+    _client_start(test);
+    if (!_client_acked(test)) {
+        DEBUG("bulk: no ack\n");
+        res = (test->state == CLIENT_BUSY) ? -EBUSY : -ETIMEDOUT;
+        goto finish;
+    }
+    int32_t sent = _bulk_send(params, &test->remote);
+    if (sent < 0) {
+        res = sent;
+        goto finish;
+    }
+    result->sent = sent;
+    test->state = CLIENT_SENT;
+    /* the last data packets may still fill the packet buffer */
+    for (unsigned i = 0; i < PACKET_TIMEOUT / BULK_BACKOFF_USEC; i++) {
+        if (!_is_full(res = sock_udp_send(&sock, &end, sizeof(end),
+                                          &test->remote))) {
+            break;
+        }
+        xtimer_usleep(BULK_BACKOFF_USEC);
+    }
+    if (res < 0) {
+        goto finish;
+    }
+    if (!_client_wait(test, CLIENT_SENT, THROUGHPUT_TIMEOUT)) {
+        DEBUG("bulk: no result\n");
+        res = -ETIMEDOUT;
+        goto finish;
+    }
+    uint32_t received = byteorder_ntohl(test->report.received);
+    result->goodput = byteorder_ntohl(test->report.goodput);
+    result->reordered = byteorder_ntohl(test->report.reordered);
+    result->duplicates = byteorder_ntohl(test->report.duplicates);
+    result->lost = (received < result->sent) ? result->sent - received : 0;
+    res = 0;
 finish:
-        DEBUG("Done throughput calculation :)\n");
-        if (!linked_list_node_exists(&node->addr)) {
-            linked_list_update_throughput(node);
+    neighbor_table_update_bulk(addr, result->goodput, result->sent,
+                               result->lost, result->reordered,
+                               result->duplicates);
+    _client_unlock();
+    return res;
+}
+
+int db_measure_neighbor_bulk(const ipv6_addr_t *addr,
+                             const udp_bulk_params_t *params,
+                             udp_bulk_result_t *result)
+{
+    assert(addr && params && result);
+    return _bulk_neighbor(addr, 0, params, result);
+}
+
+int db_measure_network_bulk(const udp_bulk_params_t *params)
+{
+    void *state = NULL;
+    gnrc_ipv6_nib_nc_t nce;
+    udp_bulk_result_t result;
+    bool first = true;
+
+    neighbor_table_sync();
+    while (gnrc_ipv6_nib_nc_iter(0, &state, &nce)) {
+        if (!first) {
+            xtimer_usleep(CONFIG_DCA_UDP_GUARD_MS * US_PER_MS);
         }
-        else {
-            linked_list_insert_node(node);
+        first = false;
+        int res = _bulk_neighbor(&nce.ipv6, gnrc_ipv6_nib_nc_get_iface(&nce),
+                                 params, &result);
+        if (res == -EINVAL) {
+            return res;
         }
-        free(udp_packet);
-        sock_udp_close(&sock);
-        xtimer_usleep(US_PER_SEC);
     }
     return 0;
 }
 
+static void *_bulk_thread(void *arg)
+{
+    (void)arg;
+    db_measure_network_bulk(&_bulk_params);
+    mutex_lock(&_bulk_lock);
+    _bulk_running = false;
+    mutex_unlock(&_bulk_lock);
+    return NULL;
+}
+
+int db_measure_network_bulk_async(const udp_bulk_params_t *params)
+{
+    assert(params);
+    int res = 0;
+
+    mutex_lock(&_bulk_lock);
+    if (_bulk_running) {
+        res = -EBUSY;
+    }
+    else {
+        /* the thread of the last test has exited, its stack is free */
+        _bulk_params = *params;
+        res = thread_create(_bulk_stack, sizeof(_bulk_stack),
+                            THREAD_PRIORITY_MAIN + 1, THREAD_CREATE_STACKTEST,
+                            _bulk_thread, NULL, "dca_bulk");
+        if (res > KERNEL_PID_UNDEF) {
+            _bulk_running = true;
+            res = 0;
+        }
+    }
+    mutex_unlock(&_bulk_lock);
+    return res;
+}
+
 int db_start_udp_server(void)
 {
     if ((server_running == false) &&
@@ -233,10 +1439,58 @@ int db_start_udp_server(void)
 
 #ifdef CONFIG_DCA_SHELL
 
+static int _bulk(int argc, char **argv)
+{
+    udp_bulk_params_t params;
+    udp_bulk_result_t result;
+    void *state = NULL;
+    gnrc_ipv6_nib_nc_t nce;
+
+    udp_bulk_params_init(&params);
+    for (int i = 0; i < argc; i += 2) {
+        if ((i + 1 >= argc) ||
+            (udp_bulk_params_set(&params, argv[i], argv[i + 1]) < 0)) {
+            printf("invalid setting %s\n", argv[i]);
+            return 1;
+        }
+    }
+    while (gnrc_ipv6_nib_nc_iter(0, &state, &nce)) {
+        char addr_str[IPV6_ADDR_MAX_STR_LEN];
+        int res = db_measure_neighbor_bulk(&nce.ipv6, &params, &result);
+        ipv6_addr_to_str(addr_str, &nce.ipv6, sizeof(addr_str));
+        if (res < 0) {
+            printf("%s: failed (%d)\n", addr_str, res);
+            if (res == -EINVAL) {
+                return 1;
+            }
+            continue;
+        }
+        printf("%s: goodput %" PRIu32 " bytes/s, sent %" PRIu32
+               ", lost %" PRIu32 ", reordered %" PRIu32
+               ", duplicates %" PRIu32 "\n", addr_str, result.goodput,
+               result.sent, result.lost, result.reordered, result.duplicates);
+    }
+    return 0;
+}
+
 int _throughput(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    if ((argc == 2) && (strcmp(argv[1], "train") == 0)) {
+        return db_measure_network_bandwidth();
+    }
+    if ((argc == 2) && (strcmp(argv[1], "delay") == 0)) {
+        return db_measure_network_delay();
+    }
+    if ((argc >= 2) && (strcmp(argv[1], "bulk") == 0)) {
+        return _bulk(argc - 2, argv + 2);
+    }
+    if (argc != 1) {
+        printf("usage: %s [train | delay | "
+               "bulk [<time|bytes|size|rate> <value>]...]\n"
+               "  time: ms (0: until bytes are sent), bytes, size: bytes,\n"
+               "  rate: bytes/s (0: as fast as possible)\n", argv[0]);
+        return 1;
+    }
     return db_measure_network_throughput();
 }
 